@@ -19,10 +19,16 @@
 
 // Project
 #include "AudioWorker.h"
+#include "CoverRegistry.h"
+#include "LibavEncoder.h"
+#include "DirectoryIndex.h"
+#include "DirectoryContext.h"
+#include "FileClassifier.h"
 
 // C++
 #include <iostream>
 #include <bitset>
+#include <algorithm>
 
 // Qt
 #include <QStringList>
@@ -32,6 +38,7 @@ extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavutil/avutil.h>
+#include <libavutil/opt.h>
 }
 
 // tagparser
@@ -44,12 +51,7 @@ extern "C"
 // Qt
 #include <QUuid>
 #include <QTemporaryFile>
-
-// libcue
-extern "C"
-{
-#include <libcue.h>
-}
+#include <QElapsedTimer>
 
 QMutex AudioWorker::s_mutex;
 
@@ -64,6 +66,10 @@ AudioWorker::AudioWorker(const QFileInfo &origin_info, const Utils::TranscoderCo
 , m_audio_decoder_context{nullptr}
 , m_frame                {nullptr}
 , m_audio_stream_id      {-1}
+, m_converter            {nullptr}
+, m_converted            {nullptr}
+, m_decoded_bytes        {0}
+, m_converted_bytes      {0}
 {
 }
 
@@ -72,7 +78,18 @@ void AudioWorker::run_implementation()
 {
   if(init_libav())
   {
+    QElapsedTimer timer;
+    timer.start();
+
     transcode();
+
+    if(m_audio_decoder_context && m_audio_decoder_context->thread_count > 1 && !has_failed() && !has_been_cancelled())
+    {
+      emit information_message(QString("Transcoded '%1' (%2) in %3 seconds using %4 decoding threads.").arg(m_source_info.absoluteFilePath())
+                                                                                                         .arg(m_audio_decoder->name)
+                                                                                                         .arg(timer.elapsed() / 1000.0, 0, 'f', 2)
+                                                                                                         .arg(m_audio_decoder_context->thread_count));
+    }
   }
   else
   {
@@ -125,12 +142,36 @@ bool AudioWorker::init_libav()
     return false;
   }
 
-  if(m_libav_context->nb_streams != 1 && !Utils::isVideoFile(m_source_info) && m_configuration.extractMetadataCoverPicture())
+  if(m_libav_context->nb_streams != 1 && FileClassifier::classify(m_source_info) != FileClassifier::Kind::VIDEO && m_configuration.extractMetadataCoverPicture())
   {
     init_libav_cover_extraction();
   }
 
+  if(m_configuration.writeOutputTags())
+  {
+    init_output_cover();
+  }
+
   AVStream *stream = m_libav_context->streams[m_audio_stream_id];
+
+  if(can_copy_stream(stream))
+  {
+    m_information.init         = true;
+    m_information.samplerate   = stream->codecpar->sample_rate;
+    m_information.num_channels = stream->codecpar->ch_layout.nb_channels;
+    m_information.format       = Sample_format::UNDEFINED;
+    m_information.passthrough  = true;
+
+    emit information_message(QString("The audio stream of '%1' is already MP3, it will be copied without transcoding.").arg(source_name));
+
+    m_packet = av_packet_alloc();
+
+    return true;
+  }
+
+  // the file couldn't be rewound after checking the stream.
+  if(has_failed()) return false;
+
   const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
   m_audio_decoder_context = avcodec_alloc_context3(codec);
 
@@ -140,6 +181,14 @@ bool AudioWorker::init_libav()
     return false;
   }
 
+  if(m_audio_decoder->capabilities & (AV_CODEC_CAP_FRAME_THREADS|AV_CODEC_CAP_SLICE_THREADS))
+  {
+    m_audio_decoder_context->thread_count = acquire_decoder_threads();
+    m_audio_decoder_context->thread_type  = FF_THREAD_FRAME|FF_THREAD_SLICE;
+  }
+
+  negotiate_decoder_format();
+
   value = avcodec_open2(m_audio_decoder_context, m_audio_decoder, nullptr);
   if (value < 0 || !avcodec_is_open(m_audio_decoder_context))
   {
@@ -147,6 +196,11 @@ bool AudioWorker::init_libav()
     return false;
   }
 
+  if(m_audio_decoder_context->thread_count > 1)
+  {
+    emit information_message(QString("Decoding '%1' (%2) using %3 threads.").arg(source_name).arg(m_audio_decoder->name).arg(m_audio_decoder_context->thread_count));
+  }
+
   m_packet = av_packet_alloc();
   m_frame  = av_frame_alloc();
 
@@ -155,6 +209,7 @@ bool AudioWorker::init_libav()
   m_information.num_channels = m_audio_decoder_context->ch_layout.nb_channels;
   m_information.format       = Sample_format::UNDEFINED;
   m_information.isFlac       = m_source_info.fileName().endsWith("flac", Qt::CaseInsensitive);
+  m_information.equivalent_bitrate = equivalent_mp3_bitrate(stream);
 
   switch(m_audio_decoder_context->sample_fmt)
   {
@@ -182,17 +237,74 @@ bool AudioWorker::init_libav()
     case AV_SAMPLE_FMT_DBLP:
       m_information.format = Sample_format::DOUBLE_PLANAR;
       break;
-    default: // unsupported sample formats.
-    case AV_SAMPLE_FMT_U8P:
-    case AV_SAMPLE_FMT_U8:
-      emit error_message(QString("Couldn't transcode '%1', because it has an unsupported sample format (8 bits).").arg(source_name));
-      return false;
+    default: // unsupported sample formats, converted.
       break;
   }
 
+  return init_converter();
+}
+
+//-----------------------------------------------------------------
+void AudioWorker::negotiate_decoder_format()
+{
+  // only a hint, decoders with a fixed output format ignore it.
+  m_audio_decoder_context->request_sample_fmt = LibavEncoder::sample_format(preferred_sample_format());
+
+  // some decoders (ac3, eac3) can downmix while decoding, cheaper than doing it afterwards.
+  if(m_audio_decoder_context->ch_layout.nb_channels > 2)
+  {
+    const AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+    av_opt_set_chlayout(m_audio_decoder_context, "downmix", &stereo, AV_OPT_SEARCH_CHILDREN);
+  }
+}
+
+//-----------------------------------------------------------------
+bool AudioWorker::init_converter()
+{
+  if(m_information.format != Sample_format::UNDEFINED && m_information.num_channels <= 2) return true;
+
+  const auto format = preferred_sample_format();
+
+  AVChannelLayout layout;
+  av_channel_layout_default(&layout, std::min(2, m_information.num_channels));
+
+  // format conversion and downmix in a single pass.
+  auto value = swr_alloc_set_opts2(&m_converter, &layout, LibavEncoder::sample_format(format), m_information.samplerate,
+                                   &m_audio_decoder_context->ch_layout, m_audio_decoder_context->sample_fmt, m_information.samplerate, 0, nullptr);
+  if(value >= 0) value = swr_init(m_converter);
+
+  if(value < 0)
+  {
+    emit error_message(QString("Couldn't transcode '%1', because its sample format or channels can't be converted. Error is \"%2\".").arg(m_source_info.absoluteFilePath()).arg(av_error_string(value)));
+    return false;
+  }
+
+  emit information_message(QString("Converting the decoded samples of '%1' from %2 with %3 channels.").arg(m_source_info.absoluteFilePath())
+                                                                                                     .arg(av_get_sample_fmt_name(m_audio_decoder_context->sample_fmt))
+                                                                                                     .arg(m_information.num_channels));
+
+  m_converted = av_frame_alloc();
+  m_information.format       = format;
+  m_information.num_channels = layout.nb_channels;
+
   return true;
 }
 
+//-----------------------------------------------------------------
+void AudioWorker::init_output_cover()
+{
+  // attached pictures are read by libav when the file is opened.
+  for(unsigned int i = 0; i < m_libav_context->nb_streams; ++i)
+  {
+    const auto stream = m_libav_context->streams[i];
+    if((stream->disposition & AV_DISPOSITION_ATTACHED_PIC) && stream->attached_pic.size > 0)
+    {
+      m_output_cover = QByteArray(reinterpret_cast<const char *>(stream->attached_pic.data), stream->attached_pic.size);
+      return;
+    }
+  }
+}
+
 //-----------------------------------------------------------------
 void AudioWorker::init_libav_cover_extraction()
 {
@@ -219,22 +331,6 @@ void AudioWorker::init_libav_cover_extraction()
       default:
         break;
     }
-
-    auto cover_name = m_source_path + m_configuration.coverPictureName() + m_cover_extension;
-
-    if(!QFile::exists(cover_name))
-    {
-      // if there are several files with the same cover I just need one of the workers to dump the cover, not all of them.
-      QFile file(cover_name);
-      auto opened = file.open(QIODevice::WriteOnly|QIODevice::Append);
-      if(opened)
-        file.close();
-    }
-    else
-    {
-      // the rest of workers will ignore the cover stream.
-      m_cover_stream_id = -1;
-    }
   }
 }
 
@@ -251,6 +347,18 @@ void AudioWorker::deinit_libav()
     avcodec_free_context(&m_audio_decoder_context);
   }
 
+  release_decoder_threads();
+
+  if(m_converter)
+  {
+    swr_free(&m_converter);
+  }
+
+  if(m_converted)
+  {
+    av_frame_free(&m_converted);
+  }
+
   if(m_frame)
   {
     av_frame_free(&m_frame);
@@ -276,11 +384,46 @@ QString AudioWorker::av_error_string(const int error_num) const
 }
 
 //-----------------------------------------------------------------
-bool AudioWorker::encode_buffers(unsigned int buffer_start, unsigned int buffer_length)
+bool AudioWorker::encode_buffers()
 {
   unsigned char *buffer1 = nullptr;
   unsigned char *buffer2 = nullptr;
 
+  const auto bytes = av_samples_get_buffer_size(nullptr, m_frame->ch_layout.nb_channels, m_frame->nb_samples, static_cast<AVSampleFormat>(m_frame->format), 1);
+  m_decoded_bytes += std::max(0, bytes);
+
+  if(m_converter)
+  {
+    const auto samples = swr_get_out_samples(m_converter, m_frame->nb_samples);
+    if(samples > m_converted->nb_samples)
+    {
+      av_frame_unref(m_converted);
+      m_converted->format     = LibavEncoder::sample_format(m_information.format);
+      m_converted->nb_samples = samples;
+      av_channel_layout_default(&m_converted->ch_layout, m_information.num_channels);
+
+      if(av_frame_get_buffer(m_converted, 0) < 0)
+      {
+        emit error_message(QString("Couldn't allocate the converted samples of '%1'.").arg(m_source_info.absoluteFilePath()));
+        return false;
+      }
+    }
+
+    const auto count = swr_convert(m_converter, m_converted->extended_data, samples, const_cast<const uint8_t **>(m_frame->extended_data), m_frame->nb_samples);
+    if(count < 0)
+    {
+      emit error_message(QString("Error converting the decoded samples of '%1'. %2").arg(m_source_info.absoluteFilePath()).arg(av_error_string(count)));
+      return false;
+    }
+
+    m_converted_bytes += std::max(0, bytes);
+
+    buffer1 = m_converted->extended_data[0];
+    buffer2 = m_information.num_channels > 1 ? m_converted->extended_data[1] : nullptr;
+
+    return count == 0 || encode_samples(count, buffer1, buffer2);
+  }
+
   switch(m_audio_decoder_context->sample_fmt)
   {
     case AV_SAMPLE_FMT_S16:
@@ -290,6 +433,7 @@ bool AudioWorker::encode_buffers(unsigned int buffer_start, unsigned int buffer_
       buffer1 = m_frame->data[0];
       break;
     case AV_SAMPLE_FMT_S16P:
+    case AV_SAMPLE_FMT_S32P:
     case AV_SAMPLE_FMT_FLTP:
     case AV_SAMPLE_FMT_DBLP:
       buffer1 = m_frame->extended_data[0];
@@ -299,7 +443,7 @@ bool AudioWorker::encode_buffers(unsigned int buffer_start, unsigned int buffer_
       break;
   }
 
-  return encode(buffer_start, buffer_length, buffer1, buffer2);
+  return encode_samples(m_frame->nb_samples, buffer1, buffer2);
 }
 
 //-----------------------------------------------------------------
@@ -322,9 +466,18 @@ void AudioWorker::transcode()
       emit progress(progressVal);
     }
 
-    // decode audio and encode it to mp3
-    if (m_packet->stream_index == m_audio_stream_id)
+    // copy the mp3 frames as they are.
+    if (m_packet->stream_index == m_audio_stream_id && m_information.passthrough)
+    {
+      if(!process_compressed_packet())
+      {
+        m_fail = true;
+        return;
+      }
+    }
+    else if (m_packet->stream_index == m_audio_stream_id)
     {
+      // decode audio and encode it to mp3
       // Audio packets can have multiple audio frames in a single packet
       while (m_packet->size > 0)
       {
@@ -336,13 +489,10 @@ void AudioWorker::transcode()
       }
     }
 
-    // dump the cover
+    // store the cover
     if(m_packet->stream_index == m_cover_stream_id)
     {
-      if(!extract_cover_picture())
-      {
-        emit error_message(QString("Error extracting cover picture for file '%1.").arg(m_source_info.absoluteFilePath()));
-      }
+      extract_cover_picture();
     }
 
     m_packet->size = 0;
@@ -355,11 +505,17 @@ void AudioWorker::transcode()
   if(value < 0 && value != AVERROR_EOF)
   {
     emit error_message(QString("Error reading input file '%1. %2").arg(m_source_info.absoluteFilePath()).arg(av_error_string(value)));
+    m_fail = true;
     return;
   }
 
+  if(!m_cover_data.isEmpty() && !save_cover_picture(m_cover_data, m_cover_extension))
+  {
+    emit error_message(QString("Error extracting cover picture for file '%1.").arg(m_source_info.absoluteFilePath()));
+  }
+
   // flush buffered frames from the decoder
-  if (m_audio_decoder->capabilities & AV_CODEC_CAP_DELAY)
+  if (!m_information.passthrough && (m_audio_decoder->capabilities & AV_CODEC_CAP_DELAY))
   {
     m_packet = av_packet_alloc();
 
@@ -373,7 +529,24 @@ void AudioWorker::transcode()
     m_packet->size = 0;
   }
 
-  close_destination_file();
+  if(m_decoded_bytes > 0)
+  {
+    add_conversion_statistics(m_audio_decoder->name, m_decoded_bytes, m_converted_bytes);
+  }
+
+  if(!close_destination_file()) return;
+
+  if(m_configuration.verifyCueSplit() && number_of_tracks() > 1 && !m_information.passthrough)
+  {
+    const auto stream = m_libav_context->streams[m_audio_stream_id];
+    long long expected_samples = 0;
+    if(stream->duration != AV_NOPTS_VALUE)
+    {
+      expected_samples = av_rescale_q(stream->duration, stream->time_base, AVRational{1, m_information.samplerate});
+    }
+
+    verify_split(expected_samples);
+  }
 }
 
 //-----------------------------------------------------------------
@@ -407,82 +580,200 @@ bool AudioWorker::process_audio_packet()
     m_packet->size -= result;
     m_packet->data += result;
 
-    if(destination().duration == 0)
+    if (!encode_buffers())
     {
-      if (!encode_buffers(0, m_frame->nb_samples))
-      {
-        return false;
-      }
+      return false;
     }
-    else
+  }
+
+  if(result == AVERROR_EOF || result == AVERROR(EAGAIN))
+  {
+    m_packet->size = 0;
+    m_packet->data = nullptr;
+  }
+  else
+  {
+    emit error_message(QString("Error reading input file '%1. %2").arg(m_source_info.absoluteFilePath()).arg(av_error_string(result)));
+    return false;
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool AudioWorker::process_compressed_packet()
+{
+  const auto stream  = m_libav_context->streams[m_audio_stream_id];
+  const auto samples = av_rescale_q(m_packet->duration, stream->time_base, AVRational{1, static_cast<int>(m_information.samplerate)});
+  const auto position = m_source_samples;
+  m_source_samples += samples;
+
+  // frames with most of its samples in a discarded pregap are discarded.
+  if((position + samples / 2) < destination().start)
+  {
+    return true;
+  }
+
+  if(destination().end != 0 && destination().end <= position + samples)
+  {
+    // MP3 frames can't be splitted without decoding, the frame goes to the track that has most of its samples.
+    const bool belongs_to_current = ((destination().end - position) * 2 > samples);
+
+    if(belongs_to_current && !write_compressed_data(m_packet->data, m_packet->size))
     {
-      if (destination().duration <= m_frame->nb_samples)
-      {
-        auto remaining_samples = destination().duration;
+      return false;
+    }
 
-        if (!encode_buffers(0, remaining_samples))
-        {
-          return false;
-        }
+    if(!close_destination_file() || !open_next_destination_file())
+    {
+      return false;
+    }
 
-        close_destination_file();
+    if(!belongs_to_current && (position + samples / 2) >= destination().start && !write_compressed_data(m_packet->data, m_packet->size))
+    {
+      return false;
+    }
 
-        if(!open_next_destination_file())
-        {
-          return false;
-        }
+    return true;
+  }
 
-        if(destination().duration != 0)
-        {
-          destination().duration -= m_frame->nb_samples - remaining_samples;
-        }
+  return write_compressed_data(m_packet->data, m_packet->size);
+}
 
-        if (!encode_buffers(remaining_samples, m_frame->nb_samples - remaining_samples))
-        {
-          return false;
-        }
+//-----------------------------------------------------------------
+bool AudioWorker::can_copy_stream(const AVStream *stream)
+{
+  const auto parameters = stream->codecpar;
+
+  if(parameters->codec_id != AV_CODEC_ID_MP3) return false;
+
+  // the additional outputs need the decoded samples.
+  if(!m_configuration.additionalProfiles().isEmpty()) return false;
+
+  // unknown bitrate, can't guarantee it's within the configured one.
+  if(parameters->bit_rate <= 0) return false;
+
+  // in VBR and ABR modes the limit is the average bitrate of the configured settings.
+  if((parameters->bit_rate / 1000) > requested_bitrate()) return false;
+
+  return is_constant_bitrate_stream();
+}
+
+//-----------------------------------------------------------------
+bool AudioWorker::is_constant_bitrate_stream()
+{
+  auto packet = av_packet_alloc();
+  if(!packet) return false;
+
+  bool constant     = true;
+  int  bitrate_bits = -1;
+  int  packets      = 0;
+
+  while(constant && packets < CBR_PROBE_PACKETS && av_read_frame(m_libav_context, packet) == 0)
+  {
+    if(packet->stream_index == m_audio_stream_id)
+    {
+      ++packets;
+
+      const auto data = packet->data;
+
+      // the packets must start with the header of a frame, the free format bitrate can't be checked.
+      if(packet->size < 4 || data[0] != 0xFF || (data[1] & 0xE0) != 0xE0 || (data[2] & 0xF0) == 0)
+      {
+        constant = false;
       }
       else
       {
-        destination().duration -= m_frame->nb_samples;
+        const int bits = (data[2] >> 4) & 0x0F;
+        if(bitrate_bits == -1) bitrate_bits = bits;
 
-        if (!encode_buffers(0, m_frame->nb_samples))
-        {
-          return false;
-        }
+        constant = (bits == bitrate_bits);
       }
     }
-  }
 
-  if(result == AVERROR_EOF || result == AVERROR(EAGAIN))
-  {
-    m_packet->size = 0;
-    m_packet->data = nullptr;
+    av_packet_unref(packet);
   }
-  else
+
+  av_packet_free(&packet);
+
+  // the stream is read again from the start, to copy or to decode it.
+  if(av_seek_frame(m_libav_context, -1, 0, AVSEEK_FLAG_BACKWARD) < 0 &&
+     av_seek_frame(m_libav_context, -1, 0, AVSEEK_FLAG_BYTE) < 0)
   {
-    emit error_message(QString("Error reading input file '%1. %2").arg(m_source_info.absoluteFilePath()).arg(av_error_string(result)));
+    emit error_message(QString("Couldn't rewind '%1' after checking its audio stream.").arg(m_source_info.absoluteFilePath()));
+    m_fail = true;
     return false;
   }
 
-  return true;
+  return constant && packets > 0;
 }
 
 //-----------------------------------------------------------------
-bool AudioWorker::extract_cover_picture() const
+int AudioWorker::equivalent_mp3_bitrate(const AVStream *stream) const
 {
-  auto cover_name = m_source_path + m_configuration.coverPictureName() + m_cover_extension;
+  const auto parameters = stream->codecpar;
 
-  QFile file(cover_name);
-  if(!file.open(QIODevice::WriteOnly|QIODevice::Unbuffered|QIODevice::Append))
+  auto bitrate = parameters->bit_rate;
+  if(bitrate <= 0 && m_libav_context->nb_streams == 1)
   {
-    emit error_message(QString("Couldn't create cover picture file for '%1', check file permissions.").arg(m_source_info.absoluteFilePath()));
-    return false;
+    bitrate = m_libav_context->bit_rate;
   }
 
-  file.write(reinterpret_cast<const char *>(m_packet->data), static_cast<long long int>(m_packet->size));
-  file.flush();
-  file.close();
+  if(bitrate <= 0) return 0;
+
+  // approximate quality of the lossy codecs compared to MP3 at the same bitrate.
+  double efficiency = 0;
+  switch(parameters->codec_id)
+  {
+    case AV_CODEC_ID_MP2:
+    case AV_CODEC_ID_AC3:
+      efficiency = 0.8;
+      break;
+    case AV_CODEC_ID_MP3:
+    case AV_CODEC_ID_WMAV1:
+    case AV_CODEC_ID_WMAV2:
+    case AV_CODEC_ID_EAC3:
+      efficiency = 1.0;
+      break;
+    case AV_CODEC_ID_VORBIS:
+      efficiency = 1.3;
+      break;
+    case AV_CODEC_ID_AAC:
+      efficiency = 1.4;
+      break;
+    case AV_CODEC_ID_OPUS:
+      efficiency = 1.6;
+      break;
+    default: // lossless, PCM or unknown codecs.
+      return 0;
+  }
+
+  return static_cast<int>((bitrate / 1000) * efficiency);
+}
+
+//-----------------------------------------------------------------
+void AudioWorker::extract_cover_picture()
+{
+  m_cover_data.append(reinterpret_cast<const char *>(m_packet->data), m_packet->size);
+}
+
+//-----------------------------------------------------------------
+bool AudioWorker::save_cover_picture(const QByteArray &data, const QString &extension)
+{
+  QString file_name;
+  const auto result = CoverRegistry::register_cover(m_source_path, m_configuration.coverPictureName(), extension, data, file_name);
+
+  switch(result)
+  {
+    case CoverRegistry::Result::FAILED:
+      emit error_message(QString("Couldn't create cover picture file for '%1', check file permissions.").arg(m_source_info.absoluteFilePath()));
+      return false;
+    case CoverRegistry::Result::DIFFERENT:
+      emit information_message(QString("Cover picture of '%1' differs from the one already in the folder, saved as '%2'.").arg(m_source_info.absoluteFilePath()).arg(file_name));
+      break;
+    default:
+      break;
+  }
 
   return true;
 }
@@ -492,66 +783,56 @@ QList<AudioWorker::Destination> AudioWorker::compute_destinations()
 {
   QList<Destination> destinations;
 
-  QStringList filter;
-  filter << "*.cue";
-
-  auto files = Utils::findFiles(QDir(m_source_path), filter);
-  auto source_name = QDir::fromNativeSeparators(m_source_info.absoluteFilePath()).split('/').last();
-  auto source_cue_name1 = m_source_path + source_name + QString(".cue");
-  auto source_basename = source_name.remove(source_name.split('.').last());
-  auto source_cue_name2 = m_source_path + source_basename + QString("cue");
+  const auto name = m_configuration.useCueToSplit() ? cue_sheet_file() : QString();
 
-  if(m_configuration.useCueToSplit() && !files.empty() && (QFile::exists(source_cue_name1) || QFile::exists(source_cue_name2)))
+  if(!name.isEmpty())
   {
-    auto name = source_cue_name1;
-    if(!QFile::exists(source_cue_name1))
-    {
-      name = source_cue_name2;
-    }
-
-    QFile cue_file(name);
+    // every file of the directory shares the parsed CUE sheets.
+    QString error;
+    const auto cue_sheet = DirectoryContext::get(m_source_path)->cue_sheet(name, error);
 
-    if(!cue_file.open(QIODevice::ReadOnly))
+    if(!cue_sheet)
     {
-      emit error_message(QString("Error opening cue file '%1'.").arg(name));
+      emit error_message(error);
     }
     else
     {
-      auto content = cue_file.readAll();
-      auto cd = cue_parse_string(content.constData());
-      if(cd == nullptr)
-      {
-        emit error_message(QString("Error parsing cue file '%1'.").arg(name));
-      }
-      else
-      {
-        auto num_tracks = cd_get_ntrack(cd);
+      const auto &tracks = cue_sheet->tracks;
 
-        for(int i = 1; i < num_tracks + 1; ++i)
-        {
-          auto track = cd_get_track(cd, i);
+      // exact in integer arithmetic, CD frames are 1/75 seconds.
+      auto to_samples = [this](const long long frames)
+      {
+        return (frames * m_information.samplerate) / CD_FRAMES_PER_SECOND;
+      };
 
-          if(track_get_mode(track) != MODE_AUDIO)
-          {
-            continue;
-          }
+      const auto policy = m_configuration.cuePregapPolicy();
 
-          auto cdtext = track_get_cdtext(track);
-          auto track_name = QString(cdtext_get(PTI_TITLE, cdtext));
-          track_name.replace(QChar('/'), QChar('-'));
-          track_name.replace(QDir::separator(), QChar('-'));
-          auto track_clean_name = Utils::formatString(QString().number(i) + QString(" ") + track_name, m_configuration.formatConfiguration());
-          auto pregap = track_get_zero_pre(track);
-          auto postgap = track_get_zero_post(track);
-          auto track_length = track_get_length(track) + (pregap != -1 ? pregap:0) + (postgap != -1 ? postgap:0);
+      for(int j = 0; j < tracks.size(); ++j)
+      {
+        const auto &track = tracks.at(j);
 
-          // convert to number of samples.
-          track_length = m_information.samplerate * (track_length / CD_FRAMES_PER_SECOND);
+        auto track_name = track.title;
+        track_name.replace(QChar('/'), QChar('-'));
+        track_name.replace(QDir::separator(), QChar('-'));
+        auto track_clean_name = m_configuration.formatProgram().apply(QString().number(track.number) + QString(" ") + track_name, false);
 
-          if(i == num_tracks) track_length = 0; // encode last track till the end of data.
+        // the audio before the first track goes to it, unless the pregaps are discarded.
+        long long start = (policy == Utils::PregapPolicy::PREPEND) ? track.index0 : track.index1;
+        if(j == 0 && policy != Utils::PregapPolicy::DISCARD) start = 0;
 
-          destinations << Destination(track_clean_name, track_length);
+        long long end = 0; // encode last track till the end of data.
+        if(j + 1 < tracks.size())
+        {
+          end = (policy == Utils::PregapPolicy::APPEND) ? tracks.at(j + 1).index1 : tracks.at(j + 1).index0;
         }
+
+        Metadata metadata;
+        metadata.title  = track.title;
+        metadata.artist = track.performer.isEmpty() ? cue_sheet->performer : track.performer;
+        metadata.album  = cue_sheet->title;
+        metadata.track  = track.number;
+
+        destinations << Destination(track_clean_name, to_samples(start), to_samples(end), metadata);
       }
     }
   }
@@ -559,75 +840,168 @@ QList<AudioWorker::Destination> AudioWorker::compute_destinations()
   if(destinations.empty())
   {
     QString file_name;
+    Metadata metadata;
+
+    if(m_configuration.useMetadataToRenameOutput() || m_configuration.writeOutputTags())
+    {
+      if(!read_libav_metadata(metadata))
+      {
+        read_file_metadata(metadata);
+      }
+    }
 
     if(m_configuration.useMetadataToRenameOutput())
     {
-      const auto shortName = Utils::shortFileName(QDir::toNativeSeparators(m_source_info.absoluteFilePath()));
-      TagParser::MediaFileInfo fileInfo(shortName);
-      fileInfo.setForceFullParse(true);
+      file_name = metadata_file_name(metadata);
+    }
 
-      TagParser::Diagnostics diag;
-      TagParser::AbortableProgressFeedback progressFeedback;
+    const auto is_file = file_name.isEmpty();
+    if(is_file)
+    {
+      file_name = m_source_info.absoluteFilePath();
+    }
 
-      try
-      {
-        fileInfo.open();
-        if(fileInfo.isOpen())
-        {
-          fileInfo.parseEverything(diag, progressFeedback);
+    destinations << Destination(m_configuration.formatProgram().apply(file_name, is_file), 0, 0, metadata);
+  }
 
-          if(!fileInfo.tags().empty())
-          {
-            auto tags = fileInfo.tags().at(0);
-            tags->ensureTextValuesAreProperlyEncoded();
+  return destinations;
+}
 
-            file_name = parse_metadata(tags);
-          }
-        }
-        else
-        {
-          emit error_message(tr("Unable to parse tags from: %1.").arg(QDir::toNativeSeparators(m_source_info.absoluteFilePath())));
-        }
+//-----------------------------------------------------------------
+QString AudioWorker::cue_sheet_file() const
+{
+  const auto source_name = m_source_info.fileName();
+  const QStringList candidates{ source_name + QString(".cue"), source_name.left(source_name.lastIndexOf('.') + 1) + QString("cue") };
+
+  // the scan already listed the directory.
+  if(DirectoryIndex::contains(m_source_path))
+  {
+    const auto cue_sheets = DirectoryIndex::cue_sheets(m_source_path);
+    for(const auto &candidate: candidates)
+    {
+      for(const auto &cue_sheet: cue_sheets)
+      {
+        if(cue_sheet.compare(candidate, Qt::CaseInsensitive) == 0) return m_source_path + cue_sheet;
       }
-      catch(...)
+    }
+
+    return QString();
+  }
+
+  for(const auto &candidate: candidates)
+  {
+    if(QFile::exists(m_source_path + candidate)) return m_source_path + candidate;
+  }
+
+  return QString();
+}
+
+//-----------------------------------------------------------------
+bool AudioWorker::read_libav_metadata(Metadata &metadata) const
+{
+  if(!m_libav_context) return false;
+
+  // some containers store the tags in the audio stream instead of the container.
+  QList<const AVDictionary *> dictionaries{ m_libav_context->metadata };
+  if(m_audio_stream_id >= 0)
+  {
+    dictionaries << m_libav_context->streams[m_audio_stream_id]->metadata;
+  }
+
+  auto value = [&dictionaries](const QStringList &keys)
+  {
+    for(auto dictionary: dictionaries)
+    {
+      for(const auto &key: keys)
       {
-        for(auto error: diag)
+        const auto entry = av_dict_get(dictionary, key.toLatin1().constData(), nullptr, 0);
+        if(entry && entry->value && entry->value[0] != '\0')
         {
-          const auto message = error.context() + " -> " + error.message();
-          emit error_message(tr("Error processing file: %1 (%2)").arg(m_source_info.absoluteFilePath()).arg(QString::fromStdString(message)));
+          return QString::fromUtf8(entry->value).trimmed();
         }
       }
-
-      if(fileInfo.isOpen()) fileInfo.close();
     }
 
-    if(file_name.isEmpty())
+    return QString();
+  };
+
+  // values can be in "number/total" form.
+  auto number = [](const QString &text)
+  {
+    return text.split('/').first().trimmed().toInt();
+  };
+
+  metadata.title  = value({"title"});
+  metadata.artist = value({"artist", "album_artist"});
+  metadata.album  = value({"album"});
+  metadata.track  = number(value({"track", "tracknumber", "part_number"}));
+  metadata.disc   = number(value({"disc", "discnumber"}));
+
+  return !metadata.title.isEmpty() && (metadata.track != 0 || !metadata.artist.isEmpty());
+}
+
+//-----------------------------------------------------------------
+void AudioWorker::read_file_metadata(Metadata &metadata)
+{
+  const auto shortName = Utils::shortFileName(QDir::toNativeSeparators(m_source_info.absoluteFilePath()));
+  TagParser::MediaFileInfo fileInfo(shortName);
+
+  TagParser::Diagnostics diag;
+  TagParser::AbortableProgressFeedback progressFeedback;
+
+  try
+  {
+    fileInfo.open(true);
+    if(fileInfo.isOpen())
     {
-      file_name = m_source_info.absoluteFilePath();
-    }
+      // only the container and the tags, not the tracks data.
+      fileInfo.parseContainerFormat(diag, progressFeedback);
+      fileInfo.parseTags(diag, progressFeedback);
+
+      if(!fileInfo.tags().empty())
+      {
+        auto tags = fileInfo.tags().at(0);
+        tags->ensureTextValuesAreProperlyEncoded();
 
-    destinations << Destination(Utils::formatString(file_name, m_configuration.formatConfiguration()), 0);
+        read_tags(tags, metadata);
+      }
+    }
+    else
+    {
+      emit error_message(tr("Unable to parse tags from: %1.").arg(QDir::toNativeSeparators(m_source_info.absoluteFilePath())));
+    }
+  }
+  catch(...)
+  {
+    for(auto error: diag)
+    {
+      const auto message = error.context() + " -> " + error.message();
+      emit error_message(tr("Error processing file: %1 (%2)").arg(m_source_info.absoluteFilePath()).arg(QString::fromStdString(message)));
+    }
   }
 
-  return destinations;
+  if(fileInfo.isOpen()) fileInfo.close();
 }
 
 //-----------------------------------------------------------------
 QString AudioWorker::parse_metadata(const TagParser::Tag *tags)
 {
-  QString track_title;
+  Metadata metadata;
+  read_tags(tags, metadata);
+
+  return metadata_file_name(metadata);
+}
 
-  if(!tags) return track_title;
+//-----------------------------------------------------------------
+void AudioWorker::read_tags(const TagParser::Tag *tags, Metadata &metadata)
+{
+  if(!tags) return;
 
-  if(m_configuration.formatConfiguration().prefix_disk_num && tags->hasField(TagParser::KnownField::DiskPosition))
+  if(metadata.disc == 0 && tags->hasField(TagParser::KnownField::DiskPosition))
   {
     try
     {
-      const auto disc_num = tags->value(TagParser::KnownField::DiskPosition).toPositionInSet().position();
-      if(disc_num != 0)
-      {
-        track_title += QString::number(disc_num) + QString("-");
-      }
+      metadata.disc = tags->value(TagParser::KnownField::DiskPosition).toPositionInSet().position();
     }
     catch(const TagParser::Failure &e)
     {
@@ -640,30 +1014,35 @@ QString AudioWorker::parse_metadata(const TagParser::Tag *tags)
   }
 
   // track number
-  if (tags->hasField(TagParser::KnownField::TrackPosition) || tags->hasField(TagParser::KnownField::PartNumber))
+  if (metadata.track == 0 && (tags->hasField(TagParser::KnownField::TrackPosition) || tags->hasField(TagParser::KnownField::PartNumber)))
   {
     try
     {
-      int track_number{0};
       if(tags->hasField(TagParser::KnownField::TrackPosition))
       {
-        track_number = tags->value(TagParser::KnownField::TrackPosition).toInteger();
+        metadata.track = tags->value(TagParser::KnownField::TrackPosition).toInteger();
       }
       else
       {
-        track_number = tags->value(TagParser::KnownField::PartNumber).toInteger();
+        metadata.track = tags->value(TagParser::KnownField::PartNumber).toInteger();
       }
+    }
+    catch(const TagParser::Failure &e)
+    {
+      emit error_message(tr("Error processing tags from file: %1 (%2)").arg(m_source_info.absoluteFilePath()).arg(QString::fromLocal8Bit(e.what())));
+    }
+    catch(...)
+    {
+      emit error_message(tr("Error processing tags from file: %1").arg(m_source_info.absoluteFilePath()));
+    }
+  }
 
-      if (track_number != 0)
-      {
-        auto number_string = QString::number(track_number);
-        while (m_configuration.formatConfiguration().number_of_digits > number_string.length())
-        {
-          number_string = "0" + number_string;
-        }
-
-        track_title += number_string + QString(" - ");
-      }
+  if (metadata.artist.isEmpty() && tags->hasField(TagParser::KnownField::Artist))
+  {
+    try
+    {
+      const auto artist = tags->value(TagParser::KnownField::Artist).toString(TagParser::TagTextEncoding::Utf8);
+      metadata.artist = QString::fromStdString(artist);
     }
     catch(const TagParser::Failure &e)
     {
@@ -674,52 +1053,78 @@ QString AudioWorker::parse_metadata(const TagParser::Tag *tags)
       emit error_message(tr("Error processing tags from file: %1").arg(m_source_info.absoluteFilePath()));
     }
   }
-  else
+
+  if (metadata.album.isEmpty() && tags->hasField(TagParser::KnownField::Album))
   {
-    if (tags->hasField(TagParser::KnownField::Artist))
+    try
     {
-      try
-      {
-        const auto artist = tags->value(TagParser::KnownField::Artist).toString(TagParser::TagTextEncoding::Utf8);
-        track_title += QString::fromStdString(artist) + QString(" - ");
-      }
-      catch(const TagParser::Failure &e)
-      {
-        emit error_message(tr("Error processing tags from file: %1 (%2)").arg(m_source_info.absoluteFilePath()).arg(QString::fromLocal8Bit(e.what())));
-      }
-      catch(...)
-      {
-        emit error_message(tr("Error processing tags from file: %1").arg(m_source_info.absoluteFilePath()));
-      }
+      const auto album = tags->value(TagParser::KnownField::Album).toString(TagParser::TagTextEncoding::Utf8);
+      metadata.album = QString::fromStdString(album);
+    }
+    catch(const TagParser::Failure &e)
+    {
+      emit error_message(tr("Error processing tags from file: %1 (%2)").arg(m_source_info.absoluteFilePath()).arg(QString::fromLocal8Bit(e.what())));
+    }
+    catch(...)
+    {
+      emit error_message(tr("Error processing tags from file: %1").arg(m_source_info.absoluteFilePath()));
     }
   }
 
   // track title
-  try
+  if(metadata.title.isEmpty())
   {
-    const auto title = tags->value(TagParser::KnownField::Title).toString(TagParser::TagTextEncoding::Utf8);
-    auto qTitle = QString::fromStdString(title);
-
-    if (!qTitle.isEmpty() && !Utils::isSpaces(qTitle))
+    try
     {
-      qTitle.replace(QDir::separator(), QChar('-'));
-      qTitle.replace(QChar('/'), QChar('-'));
-      track_title += qTitle;
+      const auto title = tags->value(TagParser::KnownField::Title).toString(TagParser::TagTextEncoding::Utf8);
+      metadata.title = QString::fromStdString(title);
     }
-    else
+    catch(const TagParser::Failure &e)
     {
-      track_title.clear();
+      emit error_message(tr("Error processing tags from file: %1 (%2)").arg(m_source_info.absoluteFilePath()).arg(QString::fromLocal8Bit(e.what())));
+    }
+    catch(...)
+    {
+      emit error_message(tr("Error processing tags from file: %1").arg(m_source_info.absoluteFilePath()));
     }
   }
-  catch(const TagParser::Failure &e)
+}
+
+//-----------------------------------------------------------------
+QString AudioWorker::metadata_file_name(const Metadata &metadata) const
+{
+  auto title = metadata.title;
+
+  if (title.isEmpty() || Utils::isSpaces(title))
   {
-    emit error_message(tr("Error processing tags from file: %1 (%2)").arg(m_source_info.absoluteFilePath()).arg(QString::fromLocal8Bit(e.what())));
+    return QString();
   }
-  catch(...)
+
+  QString track_title;
+
+  if(m_configuration.formatConfiguration().prefix_disk_num && metadata.disc != 0)
   {
-    emit error_message(tr("Error processing tags from file: %1").arg(m_source_info.absoluteFilePath()));
+    track_title += QString::number(metadata.disc) + QString("-");
   }
 
+  if (metadata.track != 0)
+  {
+    auto number_string = QString::number(metadata.track);
+    while (m_configuration.formatConfiguration().number_of_digits > number_string.length())
+    {
+      number_string = "0" + number_string;
+    }
+
+    track_title += number_string + QString(" - ");
+  }
+  else if (!metadata.artist.isEmpty())
+  {
+    track_title += metadata.artist + QString(" - ");
+  }
+
+  title.replace(QDir::separator(), QChar('-'));
+  title.replace(QChar('/'), QChar('-'));
+  track_title += title;
+
   return track_title;
 }
-
@@ -31,6 +31,7 @@ extern "C"
 {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
 }
 
 namespace TagParser
@@ -69,6 +70,20 @@ class AudioWorker
      */
     QString parse_metadata(const TagParser::Tag *tags);
 
+    /** \brief Fills the empty fields of the metadata struct with the values of the tags.
+     * \param[in] tags TagParser::Tag metadata pointer.
+     * \param[inout] metadata metadata struct.
+     *
+     */
+    void read_tags(const TagParser::Tag *tags, Metadata &metadata);
+
+    /** \brief Builds the file name based on the metadata values. Returns an empty string if there
+     *         isn't enough information.
+     * \param[in] metadata metadata struct.
+     *
+     */
+    QString metadata_file_name(const Metadata &metadata) const;
+
     /** \brief Initializes libav library structures and data to decode the source file to
      *         pcm data.
      *
@@ -80,10 +95,18 @@ class AudioWorker
      */
     void deinit_libav();
 
-    /** \brief Extracts the cover picture and dumps it to the disk.
+    /** \brief Stores the cover picture data of the actual packet.
+     *
+     */
+    void extract_cover_picture();
+
+    /** \brief Writes the cover picture to the source directory if it doesn't already have a cover
+     *         with the same contents.
+     * \param[in] data picture contents.
+     * \param[in] extension picture file extension, with the dot.
      *
      */
-    bool extract_cover_picture() const;
+    bool save_cover_picture(const QByteArray &data, const QString &extension);
 
     /** \brief Helper method to get a user-friendly description of a libav error code.
      *
@@ -94,21 +117,47 @@ class AudioWorker
     AVPacket          *m_packet;          /** libav packet (encodec data).                                                 */
     int                m_cover_stream_id; /** id of the cover stream on the file, or -1 if not found or already extracted. */
     QString            m_cover_extension; /** extension of the cover picture in the file (if any, if not it's emtpy).      */
+    QByteArray         m_cover_data;      /** contents of the cover picture in the file.                                   */
 
     static const int   s_io_buffer_size = 16384+AV_INPUT_BUFFER_PADDING_SIZE;
 
-    static QMutex      s_mutex; /** mutex to init libav and write cover picture. */
+    static QMutex      s_mutex; /** mutex to init libav. */
   private:
     /** \brief Initializes additional libav structures to decode the video stream
      *         containing the cover picture of the source file.
      */
     void init_libav_cover_extraction();
 
-    /** \brief Helper method to send the buffers to encode. Returns the value of the lame library buffer
-     *         encoding method called.
+    /** \brief Gets the cover picture to write in the tags of the destination files from the
+     *         attached picture of the source file, if any.
+     *
+     */
+    void init_output_cover();
+
+    /** \brief Returns the MP3 bitrate in kbps with the same quality as the given lossy audio stream,
+     *         or 0 if the stream is lossless or its bitrate is unknown.
+     * \param[in] stream audio stream.
+     *
+     */
+    int equivalent_mp3_bitrate(const AVStream *stream) const;
+
+    /** \brief Helper method to send the buffers of the decoded frame to encode. Returns the value of the
+     *         lame library buffer encoding method called.
+     *
+     */
+    bool encode_buffers();
+
+    /** \brief Asks the decoder to output the sample format and channels consumed by the encoders, so the
+     *         decoded frames don't need to be converted. Must be called before opening the decoder.
+     *
+     */
+    void negotiate_decoder_format();
+
+    /** \brief Creates the converter of the decoded frames if the decoder couldn't output a sample format
+     *         or number of channels that the encoders support. Returns false on error.
      *
      */
-    bool encode_buffers(unsigned int buffer_start, unsigned int buffer_length);
+    bool init_converter();
 
     /** \brief Decodes the source file and encodes the resulting pcm data with the mp3
      *         codec into the destination files.
@@ -116,22 +165,66 @@ class AudioWorker
      */
     void transcode();
 
-    /** \brief Process an unique audio packet and encodes it to mp3 taking into account the duration
+    /** \brief Process an unique audio packet and encodes it to mp3 taking into account the positions
      *         of the tracks. Opens and closes destinations if the packet crosses it's boundaries.
      *
      */
     bool process_audio_packet();
 
+    /** \brief Writes an unique MP3 packet to the destination file without decoding it, taking into account
+     *         the positions of the tracks. Tracks are splitted at the MP3 frame closest to the boundary.
+     *
+     */
+    bool process_compressed_packet();
+
+    /** \brief Returns true if the given audio stream is MP3 encoded at a constant bitrate that doesn't exceed
+     *         the configured one, so it can be copied to the destination without decoding and encoding it again.
+     *         Reads the first packets of the stream to check the bitrate of the frames and rewinds the file.
+     * \param[in] stream libav audio stream.
+     *
+     */
+    bool can_copy_stream(const AVStream *stream);
+
+    /** \brief Returns true if the first packets of the audio stream are MP3 frames with the same bitrate.
+     *         The copied streams don't have a Xing/LAME header, only constant bitrate ones can be copied.
+     *
+     */
+    bool is_constant_bitrate_stream();
+
+    /** \brief Fills the metadata struct with the values already parsed by libav. Returns true if
+     *         there is enough information to build the destination file name.
+     * \param[out] metadata metadata struct.
+     *
+     */
+    bool read_libav_metadata(Metadata &metadata) const;
+
+    /** \brief Fills the empty fields of the metadata struct reading only the tags of the source file.
+     * \param[inout] metadata metadata struct.
+     *
+     */
+    void read_file_metadata(Metadata &metadata);
+
     QFile m_input_file;  /** input audio file. */
 
     virtual Destinations compute_destinations() override final;
 
-    static constexpr double CD_FRAMES_PER_SECOND = 75.0; /** frames per second in a CD. */
-
-    AVCodec           *m_audio_decoder;         /** libav audio decoder.               */
-    AVCodecContext    *m_audio_decoder_context; /** libav audio decoder context.       */
-    AVFrame           *m_frame;                 /** libav frame (decoded data).        */
-    int                m_audio_stream_id;       /** id of the audio stream in the fie. */
+    /** \brief Returns the CUE sheet of the source file, named after the file with or without its
+     *         extension, or an empty string if there isn't one.
+     *
+     */
+    QString cue_sheet_file() const;
+
+    static constexpr long long CD_FRAMES_PER_SECOND = 75; /** frames per second in a CD.                       */
+    static const int           CBR_PROBE_PACKETS    = 64; /** packets checked to copy a stream without encoding. */
+
+    AVCodec           *m_audio_decoder;         /** libav audio decoder.                                         */
+    AVCodecContext    *m_audio_decoder_context; /** libav audio decoder context.                                 */
+    AVFrame           *m_frame;                 /** libav frame (decoded data).                                  */
+    int                m_audio_stream_id;       /** id of the audio stream in the fie.                           */
+    SwrContext        *m_converter;             /** converter of the decoded frames, or nullptr if not needed.   */
+    AVFrame           *m_converted;             /** converted frame.                                             */
+    long long          m_decoded_bytes;         /** bytes of decoded samples.                                    */
+    long long          m_converted_bytes;       /** bytes of decoded samples that needed conversion.             */
 };
 
 #endif // AUDIO_WORKER_H_
@@ -19,14 +19,21 @@
 
 // Project
 #include <ConfigurationDialog.h>
+#include <Encoder.h>
 
 // Qt
 #include <QMessageBox>
+#include <QApplication>
+
+// C++
+#include <algorithm>
 
 const QStringList ConfigurationDialog::QUALITY_NAMES = { tr("Very high"), tr("High"), tr("Normal"), tr("Low"), tr("Very low") };
 const QList<int>  ConfigurationDialog::QUALITY_VALUES = { 0,2,5,7,9 };
 const QStringList ConfigurationDialog::BITRATE_NAMES = { tr("320"), tr("256"), tr("224"), tr("192"), tr("160"), tr("128"), tr("112"), tr("96"), tr("80"), tr("64") };
 const QList<int>  ConfigurationDialog::BITRATE_VALUES = { 320, 256, 224, 192, 160, 128, 112, 96, 80, 64 };
+const QStringList ConfigurationDialog::MODE_NAMES = { tr("Constant bitrate (CBR)"), tr("Variable bitrate (VBR)"), tr("Average bitrate (ABR)") };
+const QStringList ConfigurationDialog::PREGAP_NAMES = { tr("Append to previous track"), tr("Prepend to track"), tr("Discard") };
 
 //-----------------------------------------------------------------
 ConfigurationDialog::ConfigurationDialog(const Utils::TranscoderConfiguration &configuration, QWidget *parent, Qt::WindowFlags flags)
@@ -42,6 +49,20 @@ ConfigurationDialog::ConfigurationDialog(const Utils::TranscoderConfiguration &c
   m_bitrate->addItems(BITRATE_NAMES);
   m_bitrate->setCurrentIndex(0);
 
+  m_minimumBitrate->addItems(BITRATE_NAMES);
+  m_minimumBitrate->setCurrentIndex(BITRATE_VALUES.indexOf(128));
+
+  m_mode->addItems(MODE_NAMES);
+  m_mode->setCurrentIndex(0);
+
+  m_cuePregap->addItems(PREGAP_NAMES);
+  m_cuePregap->setCurrentIndex(0);
+
+  for(int i = 0; i < 10; ++i)
+  {
+    m_vbrQuality->addItem(QString("V%1").arg(i));
+  }
+
   applyConfiguration(configuration);
 
   QStringList labels = { tr("from"), tr("to") };
@@ -133,6 +154,37 @@ void ConfigurationDialog::onCoverExtractCheckStateChanged(int state)
   m_coverNameLabel->setEnabled(enabled);
 }
 
+//-----------------------------------------------------------------
+void ConfigurationDialog::onEncodingModeChanged(int index)
+{
+  // VBR doesn't use the bitrate, only the quality level.
+  const auto isVBR = (static_cast<Utils::EncodingMode>(index) == Utils::EncodingMode::VBR);
+
+  m_bitrate->setEnabled(!isVBR);
+  m_bitrateLabel->setEnabled(!isVBR);
+  m_vbrQuality->setEnabled(isVBR);
+  m_vbrQualityLabel->setEnabled(isVBR);
+}
+
+//-----------------------------------------------------------------
+void ConfigurationDialog::onAdaptBitrateCheckStateChanged(int state)
+{
+  auto enabled = (state == Qt::Checked);
+
+  m_minimumBitrate->setEnabled(enabled);
+  m_minimumBitrateLabel->setEnabled(enabled);
+}
+
+//-----------------------------------------------------------------
+void ConfigurationDialog::onCueSplitCheckStateChanged(int state)
+{
+  auto enabled = (state == Qt::Checked);
+
+  m_cuePregap->setEnabled(enabled);
+  m_cuePregapLabel->setEnabled(enabled);
+  m_verifyCueSplit->setEnabled(enabled);
+}
+
 //-----------------------------------------------------------------
 void ConfigurationDialog::applyConfiguration(const Utils::TranscoderConfiguration& configuration)
 {
@@ -141,6 +193,12 @@ void ConfigurationDialog::applyConfiguration(const Utils::TranscoderConfiguratio
   m_transcodeModule->setChecked(configuration.transcodeModule());
   m_stripMP3->setChecked(configuration.stripTagsFromMp3());
   m_cueSplit->setChecked(configuration.useCueToSplit());
+  m_cuePregap->setCurrentIndex(static_cast<int>(configuration.cuePregapPolicy()));
+  m_verifyCueSplit->setChecked(configuration.verifyCueSplit());
+
+  onCueSplitCheckStateChanged(m_cueSplit->checkState());
+  m_skipUnchanged->setChecked(configuration.skipUnchangedFiles());
+  m_watchRoot->setChecked(configuration.watchRootDirectory());
   m_renameInputFiles->setChecked(configuration.renameInputOnSuccess());
   m_renamedInputsExtension->setText(configuration.renamedInputFilesExtension());
 
@@ -148,6 +206,7 @@ void ConfigurationDialog::applyConfiguration(const Utils::TranscoderConfiguratio
   m_renamedInputsLabel->setEnabled(m_renameInputFiles->isChecked());
 
   m_renameOutput->setChecked(configuration.useMetadataToRenameOutput());
+  m_writeTags->setChecked(configuration.writeOutputTags());
   m_reformat->setChecked(configuration.reformatOutputFilename());
   m_reformatGroup->setEnabled(m_reformat->isChecked());
   m_deleteOnCancel->setChecked(configuration.deleteOutputOnCancellation());
@@ -155,6 +214,16 @@ void ConfigurationDialog::applyConfiguration(const Utils::TranscoderConfiguratio
   m_coverName->setText(configuration.coverPictureName());
   m_bitrate->setCurrentIndex(BITRATE_VALUES.indexOf(configuration.bitrate()));
   m_quality->setCurrentIndex(QUALITY_VALUES.indexOf(configuration.quality()));
+  m_mode->setCurrentIndex(static_cast<int>(configuration.encodingMode()));
+  m_vbrQuality->setCurrentIndex(configuration.vbrQuality());
+
+  onEncodingModeChanged(m_mode->currentIndex());
+
+  m_adaptBitrate->setChecked(configuration.adaptBitrateToSource());
+  m_minimumBitrate->setCurrentIndex(std::max(0, BITRATE_VALUES.indexOf(configuration.minimumBitrate())));
+  onAdaptBitrateCheckStateChanged(m_adaptBitrate->checkState());
+
+  m_additionalProfiles->setText(Utils::outputProfilesToString(configuration.additionalProfiles()));
   m_create_m3u->setChecked(configuration.createM3Ufiles());
 
   m_deleteChars->setText(configuration.formatConfiguration().chars_to_delete);
@@ -181,6 +250,58 @@ void ConfigurationDialog::applyConfiguration(const Utils::TranscoderConfiguratio
   m_titleCase->setChecked(configuration.formatConfiguration().to_title_case);
 }
 
+//-----------------------------------------------------------------
+void ConfigurationDialog::onBenchmarkButtonPressed()
+{
+  const auto configuration = getConfiguration();
+
+  // the main output, one profile of every other codec and the additional outputs.
+  QList<Utils::OutputProfile> profiles;
+  Utils::OutputProfile profile;
+  profile.mode        = configuration.encodingMode();
+  profile.bitrate     = configuration.bitrate();
+  profile.vbr_quality = configuration.vbrQuality();
+  profiles << profile;
+
+  profiles << Utils::outputProfilesFromString("AAC128, OPUS96, VORBIS128") << configuration.additionalProfiles();
+
+  QList<Utils::OutputProfile> unique;
+  for(const auto &candidate: profiles)
+  {
+    if(std::none_of(unique.cbegin(), unique.cend(), [&candidate](const Utils::OutputProfile &p) { return p.name() == candidate.name(); }))
+    {
+      unique << candidate;
+    }
+  }
+
+  const int SECONDS = 30;
+  QStringList lines;
+
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+
+  for(const auto &result: Encoder::benchmark(unique, configuration.quality(), SECONDS))
+  {
+    if(result.success)
+    {
+      lines << tr("%1: %2x realtime, %3 KiB.").arg(result.profile.name()).arg(result.realtime, 0, 'f', 1).arg(result.size / 1024);
+    }
+    else
+    {
+      lines << tr("%1: not available. %2.").arg(result.profile.name()).arg(result.error);
+    }
+  }
+
+  QApplication::restoreOverrideCursor();
+
+  QMessageBox msgBox;
+  msgBox.setWindowIcon(QIcon(":/MusicTranscoder/settings.svg"));
+  msgBox.setText(tr("Encoding %1 seconds of stereo audio on this computer:").arg(SECONDS));
+  msgBox.setInformativeText(lines.join('\n'));
+  msgBox.setStandardButtons(QMessageBox::Ok);
+  msgBox.setIcon(QMessageBox::Information);
+  msgBox.exec();
+}
+
 //-----------------------------------------------------------------
 void ConfigurationDialog::onUpButtonPressed()
 {
@@ -270,6 +391,18 @@ void ConfigurationDialog::connectSignals()
 
   connect(m_renameInputFiles,  SIGNAL(stateChanged(int)),
           this,                SLOT(onRenameInputCheckStateChanged(int)));
+
+  connect(m_mode,              SIGNAL(currentIndexChanged(int)),
+          this,                SLOT(onEncodingModeChanged(int)));
+
+  connect(m_adaptBitrate,      SIGNAL(stateChanged(int)),
+          this,                SLOT(onAdaptBitrateCheckStateChanged(int)));
+
+  connect(m_benchmark,         SIGNAL(pressed()),
+          this,                SLOT(onBenchmarkButtonPressed()));
+
+  connect(m_cueSplit,          SIGNAL(stateChanged(int)),
+          this,                SLOT(onCueSplitCheckStateChanged(int)));
 }
 
 //-----------------------------------------------------------------
@@ -282,6 +415,11 @@ const Utils::TranscoderConfiguration ConfigurationDialog::getConfiguration() con
   configuration.setDeleteOutputOnCancellation(m_deleteOnCancel->isChecked());
   configuration.setExtractMetadataCoverPicture(m_extractInputCover->isChecked());
   configuration.setQuality(QUALITY_VALUES[m_quality->currentIndex()]);
+  configuration.setEncodingMode(static_cast<Utils::EncodingMode>(m_mode->currentIndex()));
+  configuration.setVbrQuality(m_vbrQuality->currentIndex());
+  configuration.setAdaptBitrateToSource(m_adaptBitrate->isChecked());
+  configuration.setMinimumBitrate(BITRATE_VALUES[m_minimumBitrate->currentIndex()]);
+  configuration.setAdditionalProfiles(Utils::outputProfilesFromString(m_additionalProfiles->text()));
   configuration.setCreateM3Ufiles(m_create_m3u->isChecked());
   configuration.setReformatOutputFilename(m_reformat->isChecked());
   configuration.setStripTagsFromMp3(m_stripMP3->isChecked());
@@ -289,9 +427,14 @@ const Utils::TranscoderConfiguration ConfigurationDialog::getConfiguration() con
   configuration.setTranscodeModule(m_transcodeModule->isChecked());
   configuration.setTranscodeVideo(m_transcodeVideo->isChecked());
   configuration.setUseCueToSplit(m_cueSplit->isChecked());
+  configuration.setCuePregapPolicy(static_cast<Utils::PregapPolicy>(m_cuePregap->currentIndex()));
+  configuration.setVerifyCueSplit(m_verifyCueSplit->isChecked());
+  configuration.setSkipUnchangedFiles(m_skipUnchanged->isChecked());
+  configuration.setWatchRootDirectory(m_watchRoot->isChecked());
   configuration.setRenameInputOnSuccess(m_renameInputFiles->isChecked());
   configuration.setRenamedInputFilesExtension(m_renamedInputsExtension->text());
   configuration.setUseMetadataToRenameOutput(m_renameOutput->isChecked());
+  configuration.setWriteOutputTags(m_writeTags->isChecked());
 
   Utils::FormatConfiguration format;
   format.apply                     = m_reformat->isChecked();
@@ -71,6 +71,10 @@ class ConfigurationDialog
     void onDownButtonPressed();
     void onCoverExtractCheckStateChanged(int state);
     void onRenameInputCheckStateChanged(int state);
+    void onEncodingModeChanged(int index);
+    void onAdaptBitrateCheckStateChanged(int state);
+    void onCueSplitCheckStateChanged(int state);
+    void onBenchmarkButtonPressed();
 
   private:
     /** \brief Helper method to update the UI state with the configuration values.
@@ -89,6 +93,8 @@ class ConfigurationDialog
     static const QList<int>  QUALITY_VALUES; /** values of the quality levels.  */
     static const QStringList BITRATE_NAMES;  /** strings of the bitrates.       */
     static const QList<int>  BITRATE_VALUES; /** values of the bitrates.        */
+    static const QStringList MODE_NAMES;     /** strings of the encoding modes. */
+    static const QStringList PREGAP_NAMES;   /** strings of the pregap policies. */
 };
 
 #endif // CONFIGURATIONDIALOG_H_
@@ -0,0 +1,121 @@
+/*
+ File: CoverRegistry.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "CoverRegistry.h"
+#include "DirectoryIndex.h"
+
+// Qt
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+
+// C++
+#include <algorithm>
+
+QMutex                                      CoverRegistry::s_mutex;
+QHash<QString, QList<CoverRegistry::Cover>> CoverRegistry::s_directories;
+
+//-----------------------------------------------------------------
+CoverRegistry::Result CoverRegistry::register_cover(const QString &directory, const QString &name, const QString &extension, const QByteArray &data, QString &file_name)
+{
+  const auto hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+  QMutexLocker lock(&s_mutex);
+
+  // the existing covers are the ones with the given name, a different name has its own covers.
+  const auto key = directory + name;
+  if(!s_directories.contains(key))
+  {
+    s_directories.insert(key, existing_covers(directory, name));
+  }
+
+  auto &covers = s_directories[key];
+  for(const auto &cover: covers)
+  {
+    if(cover.hash == hash)
+    {
+      file_name = cover.file_name;
+      return Result::DUPLICATED;
+    }
+  }
+
+  // every existing cover file is in the registry, no need to check the disk for the name.
+  auto isUsed = [&covers](const QString &candidate)
+  {
+    return std::any_of(covers.cbegin(), covers.cend(), [&candidate](const Cover &c) { return c.file_name.compare(candidate, Qt::CaseInsensitive) == 0; });
+  };
+
+  file_name = directory + name + extension;
+  for(int i = 2; isUsed(file_name); ++i)
+  {
+    file_name = directory + name + QString(" (%1)").arg(i) + extension;
+  }
+
+  QFile file(file_name);
+  if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate) || file.write(data) != data.size())
+  {
+    return Result::FAILED;
+  }
+  file.close();
+
+  const auto result = covers.isEmpty() ? Result::WRITTEN : Result::DIFFERENT;
+  covers << Cover{hash, file_name};
+
+  return result;
+}
+
+//-----------------------------------------------------------------
+void CoverRegistry::clear()
+{
+  QMutexLocker lock(&s_mutex);
+  s_directories.clear();
+}
+
+//-----------------------------------------------------------------
+QList<CoverRegistry::Cover> CoverRegistry::existing_covers(const QString &directory, const QString &name)
+{
+  QList<Cover> covers;
+  const QStringList filters{name + ".*", name + " (*).*"};
+
+  QStringList files;
+  if(DirectoryIndex::contains(directory))
+  {
+    // the scan already listed the pictures of the directory.
+    for(const auto &picture: DirectoryIndex::covers(directory))
+    {
+      if(QDir::match(filters, picture)) files << picture;
+    }
+  }
+  else
+  {
+    files = QDir(directory).entryList(filters, QDir::Files);
+  }
+
+  for(const auto &file_name: files)
+  {
+    QFile file(directory + file_name);
+    if(file.open(QIODevice::ReadOnly))
+    {
+      covers << Cover{QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1), directory + file_name};
+    }
+  }
+
+  return covers;
+}
@@ -0,0 +1,87 @@
+/*
+ File: CoverRegistry.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COVER_REGISTRY_H_
+#define COVER_REGISTRY_H_
+
+// Qt
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+/** \class CoverRegistry
+ * \brief Keeps the cover pictures of every directory identified by the hash of their
+ *        contents, so each distinct cover is written to disk only once.
+ *
+ */
+class CoverRegistry
+{
+  public:
+    /** \brief Result of a cover registration.
+     *
+     */
+    enum class Result: char
+    {
+      WRITTEN = 0, /** first cover of the directory, written to disk.                 */
+      DUPLICATED,  /** the same cover already exists in the directory.               */
+      DIFFERENT,   /** the directory already had a different cover, written as well. */
+      FAILED       /** the cover file couldn't be written.                          */
+    };
+
+    /** \brief Registers the cover picture data for the given directory, writting it to disk if the
+     *         directory doesn't have a cover with the same contents.
+     * \param[in] directory directory path, with the separator at the end.
+     * \param[in] name cover picture file name without extension.
+     * \param[in] extension cover picture file extension, with the dot.
+     * \param[in] data picture contents.
+     * \param[out] file_name cover file name with the same contents.
+     *
+     */
+    static Result register_cover(const QString &directory, const QString &name, const QString &extension, const QByteArray &data, QString &file_name);
+
+    /** \brief Removes all the covers from the registry.
+     *
+     */
+    static void clear();
+
+  private:
+    /** \struct Cover
+     * \brief Cover picture file in a directory.
+     *
+     */
+    struct Cover
+    {
+      QByteArray hash;      /** hash of the picture contents. */
+      QString    file_name; /** picture file name.            */
+    };
+
+    /** \brief Returns the covers already on disk in the given directory with the given name.
+     * \param[in] directory directory path.
+     * \param[in] name cover picture file name without extension.
+     *
+     */
+    static QList<Cover> existing_covers(const QString &directory, const QString &name);
+
+    static QMutex                       s_mutex;       /** protects the registry.                   */
+    static QHash<QString, QList<Cover>> s_directories; /** covers of every directory and cover name. */
+};
+
+#endif // COVER_REGISTRY_H_
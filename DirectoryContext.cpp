@@ -0,0 +1,179 @@
+/*
+ File: DirectoryContext.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "DirectoryContext.h"
+#include "Utils.h"
+
+// Qt
+#include <QFile>
+#include <QMutexLocker>
+
+// libcue
+extern "C"
+{
+#include <libcue.h>
+}
+
+QMutex                                            DirectoryContext::s_mutex;
+QMutex                                            DirectoryContext::s_cue_mutex;
+QHash<QString, std::shared_ptr<DirectoryContext>> DirectoryContext::s_contexts;
+DirectoryContext::Statistics                      DirectoryContext::s_statistics;
+
+//-----------------------------------------------------------------
+DirectoryContext::DirectoryContext(const QString &directory)
+: m_directory{directory}
+, m_writable {Writable::UNKNOWN}
+{
+}
+
+//-----------------------------------------------------------------
+std::shared_ptr<DirectoryContext> DirectoryContext::get(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+
+  auto &context = s_contexts[directory];
+  if(!context)
+  {
+    context = std::make_shared<DirectoryContext>(directory);
+  }
+
+  return context;
+}
+
+//-----------------------------------------------------------------
+void DirectoryContext::clear()
+{
+  QMutexLocker lock(&s_mutex);
+  s_contexts.clear();
+  s_statistics = Statistics();
+}
+
+//-----------------------------------------------------------------
+DirectoryContext::Statistics DirectoryContext::statistics()
+{
+  QMutexLocker lock(&s_mutex);
+  return s_statistics;
+}
+
+//-----------------------------------------------------------------
+bool DirectoryContext::writable()
+{
+  QMutexLocker lock(&m_mutex);
+
+  if(m_writable != Writable::UNKNOWN)
+  {
+    QMutexLocker statistics_lock(&s_mutex);
+    ++s_statistics.probes;
+
+    return m_writable == Writable::YES;
+  }
+
+  QFile file(m_directory + Utils::TEMPORAL_FILE_EXTENSION);
+  m_writable = file.open(QFile::WriteOnly|QFile::Truncate) ? Writable::YES : Writable::NO;
+
+  if(m_writable == Writable::YES)
+  {
+    file.close();
+    file.remove();
+  }
+
+  return m_writable == Writable::YES;
+}
+
+//-----------------------------------------------------------------
+std::shared_ptr<const DirectoryContext::CueSheet> DirectoryContext::cue_sheet(const QString &file_name, QString &error)
+{
+  QMutexLocker lock(&m_mutex);
+
+  if(m_cue_sheets.contains(file_name))
+  {
+    QMutexLocker statistics_lock(&s_mutex);
+    ++s_statistics.cue_sheets;
+
+    error = m_cue_errors.value(file_name);
+    return m_cue_sheets.value(file_name);
+  }
+
+  auto sheet = parse_cue_sheet(file_name, error);
+  m_cue_sheets.insert(file_name, sheet);
+
+  if(!sheet)
+  {
+    m_cue_errors.insert(file_name, error);
+  }
+
+  return sheet;
+}
+
+//-----------------------------------------------------------------
+std::shared_ptr<const DirectoryContext::CueSheet> DirectoryContext::parse_cue_sheet(const QString &file_name, QString &error)
+{
+  QFile cue_file(file_name);
+
+  if(!cue_file.open(QIODevice::ReadOnly))
+  {
+    error = QString("Error opening cue file '%1'.").arg(file_name);
+    return nullptr;
+  }
+
+  const auto content = cue_file.readAll();
+  cue_file.close();
+
+  QMutexLocker lock(&s_cue_mutex);
+
+  auto cd = cue_parse_string(content.constData());
+  if(cd == nullptr)
+  {
+    error = QString("Error parsing cue file '%1'.").arg(file_name);
+    return nullptr;
+  }
+
+  auto sheet = std::make_shared<CueSheet>();
+  sheet->title     = QString(cdtext_get(PTI_TITLE, cd_get_cdtext(cd)));
+  sheet->performer = QString(cdtext_get(PTI_PERFORMER, cd_get_cdtext(cd)));
+
+  const auto num_tracks = cd_get_ntrack(cd);
+  for(int i = 1; i < num_tracks + 1; ++i)
+  {
+    auto track = cd_get_track(cd, i);
+
+    if(track_get_mode(track) != MODE_AUDIO)
+    {
+      continue;
+    }
+
+    const auto cdtext = track_get_cdtext(track);
+    const auto index1 = track_get_start(track);
+    const auto index0 = track_get_index(track, 0);
+
+    CueSheet::Track sheet_track;
+    sheet_track.number    = i;
+    sheet_track.index0    = (index0 >= 0 && index0 <= index1) ? index0 : index1;
+    sheet_track.index1    = index1;
+    sheet_track.title     = QString(cdtext_get(PTI_TITLE, cdtext));
+    sheet_track.performer = QString(cdtext_get(PTI_PERFORMER, cdtext));
+
+    sheet->tracks << sheet_track;
+  }
+
+  cd_delete(cd);
+
+  return sheet;
+}
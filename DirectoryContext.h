@@ -0,0 +1,136 @@
+/*
+ File: DirectoryContext.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRECTORY_CONTEXT_H_
+#define DIRECTORY_CONTEXT_H_
+
+// Qt
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+// C++
+#include <memory>
+
+/** \class DirectoryContext
+ * \brief State of a directory shared by all the workers of its files: if the directory can be
+ *        written and its parsed CUE sheets. Each context is created the first time it's needed.
+ *
+ */
+class DirectoryContext
+{
+  public:
+    /** \struct CueSheet
+     * \brief Audio tracks and album information of a CUE sheet.
+     *
+     */
+    struct CueSheet
+    {
+      /** \struct Track
+       * \brief Audio track of the CUE sheet.
+       *
+       */
+      struct Track
+      {
+        int     number;    /** track number.                                            */
+        long    index0;    /** INDEX 00 position in CD frames, INDEX 01 if there's none. */
+        long    index1;    /** INDEX 01 position in CD frames.                          */
+        QString title;     /** track title.                                             */
+        QString performer; /** track performer.                                         */
+      };
+
+      QString      title;     /** album title.     */
+      QString      performer; /** album performer. */
+      QList<Track> tracks;    /** audio tracks.    */
+    };
+
+    /** \struct Statistics
+     * \brief Filesystem operations avoided by the contexts.
+     *
+     */
+    struct Statistics
+    {
+      long long probes;     /** permission probes avoided, three operations each (create, close, remove). */
+      long long cue_sheets; /** CUE sheet reads avoided, three operations each (open, read, close).       */
+
+      Statistics(): probes{0}, cue_sheets{0} {};
+    };
+
+    /** \brief Returns the context of the given directory, creating it if necessary.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static std::shared_ptr<DirectoryContext> get(const QString &directory);
+
+    /** \brief Removes all the contexts and resets the statistics.
+     *
+     */
+    static void clear();
+
+    /** \brief Returns the filesystem operations avoided since the last clear.
+     *
+     */
+    static Statistics statistics();
+
+    /** \brief Returns true if files can be created in the directory. The directory is only probed
+     *         the first time.
+     *
+     */
+    bool writable();
+
+    /** \brief Returns the parsed CUE sheet, reading it only the first time, or nullptr on error.
+     * \param[in] file_name CUE sheet absolute file name.
+     * \param[out] error error description.
+     *
+     */
+    std::shared_ptr<const CueSheet> cue_sheet(const QString &file_name, QString &error);
+
+    /** \brief DirectoryContext class constructor.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    explicit DirectoryContext(const QString &directory);
+
+  private:
+    /** \brief Reads and parses the given CUE sheet. Returns nullptr on error.
+     * \param[in] file_name CUE sheet absolute file name.
+     * \param[out] error error description.
+     *
+     */
+    static std::shared_ptr<const CueSheet> parse_cue_sheet(const QString &file_name, QString &error);
+
+    /** \brief State of the probe of the directory.
+     *
+     */
+    enum class Writable: char { UNKNOWN = 0, YES, NO };
+
+    const QString                                   m_directory;  /** directory path.                           */
+    QMutex                                          m_mutex;      /** protects the context.                     */
+    Writable                                        m_writable;   /** result of the probe of the directory.     */
+    QHash<QString, std::shared_ptr<const CueSheet>> m_cue_sheets; /** parsed CUE sheets, nullptr if not valid.  */
+    QHash<QString, QString>                         m_cue_errors; /** errors of the CUE sheets that failed.     */
+
+    static QMutex                                            s_mutex;      /** protects the contexts and statistics.   */
+    static QMutex                                            s_cue_mutex;  /** libcue parser isn't reentrant.          */
+    static QHash<QString, std::shared_ptr<DirectoryContext>> s_contexts;   /** contexts of the directories.            */
+    static Statistics                                        s_statistics; /** filesystem operations avoided.          */
+};
+
+#endif // DIRECTORY_CONTEXT_H_
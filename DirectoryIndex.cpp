@@ -0,0 +1,156 @@
+/*
+ File: DirectoryIndex.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "DirectoryIndex.h"
+
+// Qt
+#include <QDir>
+#include <QMutexLocker>
+
+QMutex                                    DirectoryIndex::s_mutex;
+QHash<QString, DirectoryIndex::Directory> DirectoryIndex::s_directories;
+
+//-----------------------------------------------------------------
+void DirectoryIndex::clear()
+{
+  QMutexLocker lock(&s_mutex);
+  s_directories.clear();
+}
+
+//-----------------------------------------------------------------
+void DirectoryIndex::add_directory(const QString &directory, const Directory &contents)
+{
+  QMutexLocker lock(&s_mutex);
+  s_directories.insert(directory, contents);
+}
+
+//-----------------------------------------------------------------
+bool DirectoryIndex::contains(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.contains(directory);
+}
+
+//-----------------------------------------------------------------
+QStringList DirectoryIndex::directories()
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.keys();
+}
+
+//-----------------------------------------------------------------
+QStringList DirectoryIndex::media(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.value(directory).media;
+}
+
+//-----------------------------------------------------------------
+QStringList DirectoryIndex::cue_sheets(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.value(directory).cue_sheets;
+}
+
+//-----------------------------------------------------------------
+QStringList DirectoryIndex::covers(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.value(directory).covers;
+}
+
+//-----------------------------------------------------------------
+QStringList DirectoryIndex::outputs(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.value(directory).outputs;
+}
+
+//-----------------------------------------------------------------
+QStringList DirectoryIndex::playlists(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.value(directory).playlists;
+}
+
+//-----------------------------------------------------------------
+QHash<QString, DirectoryIndex::Stamp> DirectoryIndex::stamps(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.value(directory).stamps;
+}
+
+//-----------------------------------------------------------------
+QHash<QString, long long> DirectoryIndex::durations(const QString &directory)
+{
+  QMutexLocker lock(&s_mutex);
+  return s_directories.value(directory).durations;
+}
+
+//-----------------------------------------------------------------
+void DirectoryIndex::add_output(const QString &file_name, const long long duration)
+{
+  QString directory, name;
+  split(file_name, directory, name);
+
+  QMutexLocker lock(&s_mutex);
+
+  // directories created by the workers are added too, they can't be in the scan.
+  auto &contents = s_directories[directory];
+  if(!contents.outputs.contains(name, Qt::CaseInsensitive))
+  {
+    contents.outputs << name;
+  }
+
+  // written after the scan, the stamp is no longer valid.
+  contents.stamps.remove(name);
+
+  if(duration >= 0)
+  {
+    contents.durations.insert(name, duration);
+  }
+}
+
+//-----------------------------------------------------------------
+void DirectoryIndex::remove_output(const QString &file_name)
+{
+  QString directory, name;
+  split(file_name, directory, name);
+
+  QMutexLocker lock(&s_mutex);
+
+  if(s_directories.contains(directory))
+  {
+    auto &contents = s_directories[directory];
+    contents.outputs.removeIf([&name](const QString &output) { return output.compare(name, Qt::CaseInsensitive) == 0; });
+    contents.durations.removeIf([&name](const QHash<QString, long long>::iterator it) { return it.key().compare(name, Qt::CaseInsensitive) == 0; });
+    contents.stamps.removeIf([&name](const QHash<QString, Stamp>::iterator it) { return it.key().compare(name, Qt::CaseInsensitive) == 0; });
+  }
+}
+
+//-----------------------------------------------------------------
+void DirectoryIndex::split(const QString &file_name, QString &directory, QString &name)
+{
+  const auto path  = QDir::fromNativeSeparators(file_name);
+  const auto index = path.lastIndexOf('/');
+
+  directory = path.left(index + 1);
+  name      = path.mid(index + 1);
+}
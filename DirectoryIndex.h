@@ -0,0 +1,157 @@
+/*
+ File: DirectoryIndex.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRECTORY_INDEX_H_
+#define DIRECTORY_INDEX_H_
+
+// Qt
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/** \class DirectoryIndex
+ * \brief Contents of the directories found in the scan of the root directory, so the workers don't
+ *        need to list the directories again. The outputs written by the workers are added to it.
+ *
+ */
+class DirectoryIndex
+{
+  public:
+    /** \struct Stamp
+     * \brief Size and modification time of a file.
+     *
+     */
+    struct Stamp
+    {
+      long long size;     /** size in bytes.                                     */
+      long long modified; /** modification time in milliseconds since the epoch. */
+
+      Stamp(): size{-1}, modified{-1} {};
+      Stamp(long long s, long long m): size{s}, modified{m} {};
+    };
+
+    /** \struct Directory
+     * \brief Files of a directory, only the names.
+     *
+     */
+    struct Directory
+    {
+      QStringList media;      /** files to transcode.                 */
+      QStringList cue_sheets; /** CUE sheets.                         */
+      QStringList covers;     /** pictures.                           */
+      QStringList outputs;    /** MP3 files and transcoded files.     */
+      QStringList playlists;  /** M3U8 playlists.                     */
+
+      QHash<QString, long long> durations; /** durations in milliseconds of the outputs, when known.       */
+      QHash<QString, Stamp>     stamps;    /** stamps of the outputs found in the scan and not modified.    */
+    };
+
+    /** \brief Removes all the directories from the index.
+     *
+     */
+    static void clear();
+
+    /** \brief Adds the contents of a directory to the index.
+     * \param[in] directory directory path, with the separator at the end.
+     * \param[in] contents directory contents.
+     *
+     */
+    static void add_directory(const QString &directory, const Directory &contents);
+
+    /** \brief Returns true if the directory is in the index and false otherwise.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static bool contains(const QString &directory);
+
+    /** \brief Returns the paths of the directories in the index, with the separator at the end.
+     *
+     */
+    static QStringList directories();
+
+    /** \brief Returns the files to transcode of the directory, or an empty list if the directory isn't in the index.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static QStringList media(const QString &directory);
+
+    /** \brief Returns the CUE sheets of the directory, or an empty list if the directory isn't in the index.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static QStringList cue_sheets(const QString &directory);
+
+    /** \brief Returns the pictures of the directory, or an empty list if the directory isn't in the index.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static QStringList covers(const QString &directory);
+
+    /** \brief Returns the MP3 files of the directory, or an empty list if the directory isn't in the index.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static QStringList outputs(const QString &directory);
+
+    /** \brief Returns the playlists of the directory, or an empty list if the directory isn't in the index.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static QStringList playlists(const QString &directory);
+
+    /** \brief Returns the stamps of the MP3 files of the directory that haven't been modified since the scan.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static QHash<QString, Stamp> stamps(const QString &directory);
+
+    /** \brief Returns the known durations of the MP3 files of the directory, in milliseconds.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    static QHash<QString, long long> durations(const QString &directory);
+
+    /** \brief Adds a file written by a worker to the outputs of its directory.
+     * \param[in] file_name absolute file name.
+     * \param[in] duration duration of the file in milliseconds, -1 if unknown.
+     *
+     */
+    static void add_output(const QString &file_name, const long long duration = -1);
+
+    /** \brief Removes a file deleted by a worker from the outputs of its directory.
+     * \param[in] file_name absolute file name.
+     *
+     */
+    static void remove_output(const QString &file_name);
+
+  private:
+    /** \brief Splits the file name in the directory, with the separator at the end, and the name.
+     * \param[in] file_name absolute file name.
+     * \param[out] directory directory path.
+     * \param[out] name file name.
+     *
+     */
+    static void split(const QString &file_name, QString &directory, QString &name);
+
+    static QMutex                    s_mutex;       /** protects the index.         */
+    static QHash<QString, Directory> s_directories; /** contents of the directories. */
+};
+
+#endif // DIRECTORY_INDEX_H_
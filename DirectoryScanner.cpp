@@ -0,0 +1,299 @@
+/*
+ File: DirectoryScanner.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "DirectoryScanner.h"
+#include "DirectoryIndex.h"
+#include "FileClassifier.h"
+#include "LibraryIndex.h"
+#include "RunJournal.h"
+
+// Qt
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+// C++
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+
+const QStringList DirectoryScanner::PICTURE_EXTENSIONS = { "jpg", "jpeg", "png", "bmp", "tif", "tiff", "gif", "webp" };
+
+//-----------------------------------------------------------------
+DirectoryScanner::DirectoryScanner(const QString &root, const Utils::TranscoderConfiguration &configuration, QObject *parent)
+: QThread      {parent}
+, m_root       {QDir(QDir::fromNativeSeparators(root)).absolutePath()}
+, m_extensions {media_extensions(configuration)}
+, m_excluded   {output_directories(configuration)}
+, m_folders    {configuration.createM3Ufiles()}
+, m_skip       {configuration.skipUnchangedFiles()}
+, m_threads    {std::clamp(configuration.numberOfThreads(), 1, MAX_THREADS)}
+, m_busy       {0}
+, m_stop       {false}
+, m_directories{0}
+, m_files      {0}
+, m_skipped    {0}
+{
+  qRegisterMetaType<QList<QFileInfo>>("QList<QFileInfo>");
+}
+
+//-----------------------------------------------------------------
+DirectoryScanner::~DirectoryScanner()
+{
+  stop();
+  wait();
+}
+
+//-----------------------------------------------------------------
+void DirectoryScanner::stop()
+{
+  QMutexLocker lock(&m_mutex);
+  m_stop = true;
+  m_pending_condition.wakeAll();
+}
+
+//-----------------------------------------------------------------
+void DirectoryScanner::run()
+{
+  m_pending = QStringList{m_root};
+  m_busy    = 0;
+
+  std::vector<std::thread> threads;
+  for(int i = 1; i < m_threads; ++i)
+  {
+    threads.emplace_back(&DirectoryScanner::scan, this);
+  }
+
+  scan();
+
+  for(auto &thread: threads)
+  {
+    thread.join();
+  }
+}
+
+//-----------------------------------------------------------------
+void DirectoryScanner::scan()
+{
+  QList<QFileInfo> files, folders;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  auto send_batches = [&]()
+  {
+    if(!files.isEmpty())
+    {
+      emit files_found(files);
+      files.clear();
+    }
+
+    if(!folders.isEmpty())
+    {
+      emit folders_found(folders);
+      folders.clear();
+    }
+
+    timer.restart();
+  };
+
+  QString directory;
+  while(next_directory(directory))
+  {
+    QStringList subdirectories;
+    QList<QFileInfo> media;
+    DirectoryIndex::Directory contents;
+
+    // only this directory, the subdirectories are scanned by any of the threads.
+    list_directory(directory, m_extensions, m_excluded, contents, media, subdirectories);
+
+    const auto path = directory.endsWith('/') ? directory : directory + '/';
+
+    // the outputs of the sources are checked against the listing, once the whole directory is known.
+    QSet<QString> outputs;
+    if(m_skip && !media.isEmpty())
+    {
+      for(const auto &output: std::as_const(contents.outputs))
+      {
+        outputs.insert(output.toLower());
+      }
+    }
+
+    for(const auto &info: std::as_const(media))
+    {
+      // the jobs finished in an interrupted run aren't done again.
+      if(RunJournal::finished(info.absoluteFilePath()) || (m_skip && LibraryIndex::up_to_date(info, path, outputs)))
+      {
+        ++m_skipped;
+        continue;
+      }
+
+      // the headers are read here, in parallel, instead of when the worker is created.
+      FileClassifier::classify(info);
+
+      files << info;
+      ++m_files;
+    }
+
+    ++m_directories;
+    directory_scanned(subdirectories);
+
+    // the transcoded files are written to the same directory, folders without them don't need a playlist.
+    if(m_folders && (!contents.media.isEmpty() || !contents.outputs.isEmpty()))
+    {
+      folders << QFileInfo(directory);
+    }
+
+    DirectoryIndex::add_directory(path, contents);
+
+    if(files.size() + folders.size() >= BATCH_SIZE || timer.elapsed() >= BATCH_INTERVAL)
+    {
+      send_batches();
+    }
+  }
+
+  send_batches();
+}
+
+//-----------------------------------------------------------------
+QSet<QString> DirectoryScanner::media_extensions(const Utils::TranscoderConfiguration &configuration)
+{
+  QStringList filters;
+  if(configuration.transcodeAudio())
+  {
+    filters << Utils::WAVE_FILE_EXTENSIONS;
+  }
+
+  if(configuration.transcodeVideo())
+  {
+    filters << Utils::MOVIE_FILE_EXTENSIONS;
+  }
+
+  if(configuration.transcodeModule())
+  {
+    filters << Utils::MODULE_FILE_EXTENSIONS;
+  }
+
+  // the files are classified by extension, filters are "*.extension".
+  QSet<QString> extensions;
+  for(const auto &filter: filters)
+  {
+    extensions.insert(filter.mid(2).toLower());
+  }
+
+  return extensions;
+}
+
+//-----------------------------------------------------------------
+QSet<QString> DirectoryScanner::output_directories(const Utils::TranscoderConfiguration &configuration)
+{
+  QSet<QString> directories;
+  for(const auto &profile: configuration.additionalProfiles())
+  {
+    directories.insert(profile.name().toLower());
+  }
+
+  return directories;
+}
+
+//-----------------------------------------------------------------
+void DirectoryScanner::list_directory(const QString &directory, const QSet<QString> &extensions, const QSet<QString> &excluded,
+                                      DirectoryIndex::Directory &contents, QList<QFileInfo> &media, QStringList &subdirectories)
+{
+  // the file information is filled with the data of the directory entry, the files aren't opened or queried again.
+  QDirIterator it(directory, QDir::Files|QDir::Dirs|QDir::NoDotAndDotDot);
+  while(it.hasNext())
+  {
+    it.next();
+    const auto info = it.fileInfo();
+
+    if(info.isDir())
+    {
+      // the outputs of the additional profiles would be transcoded again on every run, one level deeper.
+      if(!info.isSymLink() && !excluded.contains(info.fileName().toLower())) subdirectories << info.absoluteFilePath();
+      continue;
+    }
+
+    const auto name      = info.fileName();
+    const auto extension = info.suffix().toLower();
+
+    if(extensions.contains(extension))
+    {
+      contents.media << name;
+      media << info;
+    }
+
+    if(extension == "mp3")
+    {
+      // the directory entry has the size and time, the playlists use them to detect changes.
+      contents.outputs << name;
+      contents.stamps.insert(name, DirectoryIndex::Stamp(info.size(), info.lastModified().toMSecsSinceEpoch()));
+    }
+    else if(extension == "m3u8")
+    {
+      contents.playlists << name;
+    }
+    else if(extension == "cue")
+    {
+      contents.cue_sheets << name;
+    }
+    else if(PICTURE_EXTENSIONS.contains(extension))
+    {
+      contents.covers << name;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+bool DirectoryScanner::next_directory(QString &directory)
+{
+  QMutexLocker lock(&m_mutex);
+
+  while(m_pending.isEmpty() && m_busy > 0 && !m_stop)
+  {
+    m_pending_condition.wait(&m_mutex);
+  }
+
+  if(m_stop || m_pending.isEmpty())
+  {
+    // wake the rest of the threads to end the scan.
+    m_pending_condition.wakeAll();
+    return false;
+  }
+
+  // depth first keeps the list of pending directories short.
+  directory = m_pending.takeLast();
+  ++m_busy;
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+void DirectoryScanner::directory_scanned(const QStringList &directories)
+{
+  QMutexLocker lock(&m_mutex);
+
+  m_pending << directories;
+  --m_busy;
+
+  m_pending_condition.wakeAll();
+}
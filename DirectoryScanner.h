@@ -0,0 +1,167 @@
+/*
+ File: DirectoryScanner.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRECTORY_SCANNER_H_
+#define DIRECTORY_SCANNER_H_
+
+// Project
+#include "Utils.h"
+#include "DirectoryIndex.h"
+
+// Qt
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFileInfo>
+#include <QStringList>
+#include <QSet>
+
+// C++
+#include <atomic>
+
+/** \class DirectoryScanner
+ * \brief Walks the root directory with several threads and sends the files to transcode and the folders
+ *        to create playlists in small batches as they are found, so the processing can start before
+ *        the scan ends. Every directory is listed once and its contents are stored in the DirectoryIndex.
+ *
+ */
+class DirectoryScanner
+: public QThread
+{
+    Q_OBJECT
+  public:
+    /** \brief DirectoryScanner class constructor.
+     * \param[in] root root directory of the scan.
+     * \param[in] configuration configuration struct reference.
+     * \param[in] parent raw pointer of the object parent of this one.
+     *
+     */
+    explicit DirectoryScanner(const QString &root, const Utils::TranscoderConfiguration &configuration, QObject *parent = nullptr);
+
+    /** \brief DirectoryScanner class virtual destructor.
+     *
+     */
+    virtual ~DirectoryScanner();
+
+    /** \brief Aborts the scan.
+     *
+     */
+    void stop();
+
+    /** \brief Returns the number of directories scanned.
+     *
+     */
+    int scanned_directories() const
+    { return m_directories; }
+
+    /** \brief Returns the number of files found.
+     *
+     */
+    int found_files() const
+    { return m_files; }
+
+    /** \brief Returns the number of files skipped because they were transcoded in a previous run.
+     *
+     */
+    int skipped_files() const
+    { return m_skipped; }
+
+    /** \brief Returns the extensions of the files to transcode with the given configuration, in lower case.
+     * \param[in] configuration configuration struct reference.
+     *
+     */
+    static QSet<QString> media_extensions(const Utils::TranscoderConfiguration &configuration);
+
+    /** \brief Returns the names of the subdirectories the additional outputs are written to with the given
+     *         configuration, in lower case. Their files aren't transcoded again.
+     * \param[in] configuration configuration struct reference.
+     *
+     */
+    static QSet<QString> output_directories(const Utils::TranscoderConfiguration &configuration);
+
+    /** \brief Lists the contents of a directory, without entering its subdirectories.
+     * \param[in] directory directory path.
+     * \param[in] extensions extensions of the files to transcode, in lower case.
+     * \param[in] excluded names of the subdirectories to ignore, in lower case.
+     * \param[out] contents names of the files of the directory by type.
+     * \param[out] media information of the files to transcode.
+     * \param[out] subdirectories paths of the subdirectories.
+     *
+     */
+    static void list_directory(const QString &directory, const QSet<QString> &extensions, const QSet<QString> &excluded,
+                               DirectoryIndex::Directory &contents, QList<QFileInfo> &media, QStringList &subdirectories);
+
+  signals:
+    /** \brief Sends a batch of files to transcode.
+     * \param[in] files files information.
+     *
+     */
+    void files_found(const QList<QFileInfo> &files);
+
+    /** \brief Sends a batch of folders to create playlists.
+     * \param[in] folders folders information.
+     *
+     */
+    void folders_found(const QList<QFileInfo> &folders);
+
+  protected:
+    virtual void run() override;
+
+  private:
+    static const int BATCH_SIZE     = 64;  /** maximum number of entries of a batch.              */
+    static const int BATCH_INTERVAL = 100; /** maximum milliseconds a batch is kept.               */
+    static const int MAX_THREADS    = 8;   /** maximum number of threads, the scan is I/O bound.   */
+
+    static const QStringList PICTURE_EXTENSIONS; /** extensions of the pictures, in lower case. */
+
+    /** \brief Scans directories until there are none left. Executed by every scanning thread.
+     *
+     */
+    void scan();
+
+    /** \brief Gets the next directory to scan, waiting for the other threads if there are none pending.
+     *         Returns false when the scan has ended or has been aborted.
+     * \param[out] directory directory path.
+     *
+     */
+    bool next_directory(QString &directory);
+
+    /** \brief Adds the subdirectories found scanning a directory to the pending ones and marks it as scanned.
+     * \param[in] directories subdirectories paths.
+     *
+     */
+    void directory_scanned(const QStringList &directories);
+
+    const QString    m_root;              /** root directory of the scan.                           */
+    QSet<QString>    m_extensions;        /** extensions of the files to transcode, in lower case.  */
+    QSet<QString>    m_excluded;          /** directories of the additional outputs, in lower case. */
+    const bool       m_folders;           /** true to send the folders with playlist work.          */
+    const bool       m_skip;              /** true to skip the files in the library index.          */
+    const int        m_threads;           /** number of scanning threads.                           */
+    QStringList      m_pending;           /** directories pending to be scanned.                    */
+    int              m_busy;              /** number of threads scanning a directory.               */
+    bool             m_stop;              /** true if the scan has been aborted.                    */
+    QMutex           m_mutex;             /** protects the pending directories and the flags.       */
+    QWaitCondition   m_pending_condition; /** signals new pending directories or the end of the scan. */
+    std::atomic<int> m_directories;       /** number of directories scanned.                        */
+    std::atomic<int> m_files;             /** number of files found.                                */
+    std::atomic<int> m_skipped;           /** number of files skipped, already transcoded.          */
+};
+
+#endif // DIRECTORY_SCANNER_H_
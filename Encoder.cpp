@@ -0,0 +1,116 @@
+/*
+ File: Encoder.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "Encoder.h"
+#include "LameEncoder.h"
+#include "LibavEncoder.h"
+
+// Qt
+#include <QBuffer>
+#include <QElapsedTimer>
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//-----------------------------------------------------------------
+std::unique_ptr<Encoder> Encoder::create(const Utils::OutputProfile &profile, const int quality)
+{
+  if(profile.codec == Utils::Codec::MP3)
+  {
+    return std::make_unique<LameEncoder>(quality);
+  }
+
+  return std::make_unique<LibavEncoder>(profile.codec);
+}
+
+//-----------------------------------------------------------------
+QList<Encoder::Benchmark> Encoder::benchmark(const QList<Utils::OutputProfile> &profiles, const int quality, const int seconds)
+{
+  const int    SAMPLERATE = 44100;
+  const int    BLOCK_SIZE = 4096;
+  const double TWO_PI     = 6.283185307179586;
+
+  Input input;
+  input.format     = Sample_format::FLOAT;
+  input.samplerate = SAMPLERATE;
+  input.channels   = 2;
+
+  // one second of stereo tones with some noise, so the encoders can't take shortcuts with silence.
+  std::vector<float> samples(2 * SAMPLERATE);
+  unsigned int seed = 1;
+  for(int i = 0; i < SAMPLERATE; ++i)
+  {
+    const auto time = static_cast<double>(i) / SAMPLERATE;
+    seed = seed * 1103515245 + 12345;
+    const auto noise = (static_cast<int>((seed >> 16) & 0x7FFF) - 16384) / 163840.0;
+
+    samples[2*i]   = 0.4 * std::sin(TWO_PI * 440 * time) + 0.2 * std::sin(TWO_PI * 3520 * time) + noise;
+    samples[2*i+1] = 0.4 * std::sin(TWO_PI * 660 * time) + 0.2 * std::sin(TWO_PI * 5280 * time) - noise;
+  }
+
+  QList<Benchmark> results;
+
+  for(const auto &profile: profiles)
+  {
+    Benchmark result;
+    result.profile = profile;
+
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadWrite);
+
+    auto encoder = create(profile, quality);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    result.success = encoder->init(profile, input, QMap<QString, QString>(), &buffer);
+
+    for(int second = 0; result.success && second < seconds; ++second)
+    {
+      for(int position = 0; result.success && position < SAMPLERATE; position += BLOCK_SIZE)
+      {
+        const auto block = std::min(BLOCK_SIZE, SAMPLERATE - position);
+        auto data = reinterpret_cast<unsigned char *>(samples.data() + 2 * position);
+
+        result.success = encoder->encode(data, nullptr, block);
+      }
+    }
+
+    result.success = result.success && encoder->finish();
+
+    const auto elapsed = std::max<qint64>(1, timer.elapsed());
+
+    if(result.success)
+    {
+      result.realtime = seconds * 1000.0 / elapsed;
+      result.size     = buffer.size();
+    }
+    else
+    {
+      result.error = encoder->error();
+    }
+
+    results << result;
+  }
+
+  return results;
+}
@@ -0,0 +1,149 @@
+/*
+ File: Encoder.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODER_H_
+#define ENCODER_H_
+
+// Project
+#include "Utils.h"
+
+// Qt
+#include <QString>
+#include <QMap>
+#include <QList>
+
+// C++
+#include <memory>
+
+class QIODevice;
+
+// sample formats, not all supported.
+enum class Sample_format: unsigned char { UNDEFINED = 0, SIGNED_16, FLOAT, DOUBLE, SIGNED_16_PLANAR, SIGNED_32_PLANAR, FLOAT_PLANAR, DOUBLE_PLANAR, UNSIGNED_8, UNSIGNED_8_PLANAR, SIGNED_32 };
+
+/** \class Encoder
+ * \brief Interface of the encoders of the outputs. The encoders get the decoded samples of the source
+ *        and write the compressed stream to a device opened by the worker.
+ *
+ */
+class Encoder
+{
+  public:
+    /** \struct Input
+     * \brief Format of the samples given to the encoder.
+     *
+     */
+    struct Input
+    {
+      Sample_format format;     /** sample format.                   */
+      int           samplerate; /** sample rate in Hz.               */
+      int           channels;   /** number of channels, one or two.  */
+
+      Input(): format{Sample_format::UNDEFINED}, samplerate{0}, channels{0} {};
+    };
+
+    /** \struct Benchmark
+     * \brief Result of the benchmark of an encoder.
+     *
+     */
+    struct Benchmark
+    {
+      Utils::OutputProfile profile;  /** benchmarked profile.                                  */
+      bool                 success;  /** true if the encoder could be used, false otherwise.   */
+      double               realtime; /** seconds of audio encoded per second of time.          */
+      long long            size;     /** size of the encoded stream in bytes.                  */
+      QString              error;    /** error message if the encoder failed.                  */
+
+      Benchmark(): success{false}, realtime{0}, size{0} {};
+    };
+
+    /** \brief Encoder class virtual destructor.
+     *
+     */
+    virtual ~Encoder()
+    {};
+
+    /** \brief Initializes the encoder and writes the stream headers, if any, to the device at its
+     *         current position. Returns false on error.
+     * \param[in] profile encoding settings.
+     * \param[in] input format of the samples.
+     * \param[in] tags tags to write in the stream using the libav metadata keys, ignored by
+     *                 encoders whose container is tagged by the worker.
+     * \param[in] device opened output device.
+     *
+     */
+    virtual bool init(const Utils::OutputProfile &profile, const Input &input, const QMap<QString, QString> &tags, QIODevice *device) = 0;
+
+    /** \brief Encodes the given samples and writes the compressed data to the device. Returns false
+     *         on error.
+     * \param[in] buffer1 pointer to the first sample of the first buffer (main or left).
+     * \param[in] buffer2 pointer to the first sample of the second buffer (unused or right).
+     * \param[in] samples number of samples per channel.
+     *
+     */
+    virtual bool encode(unsigned char *buffer1, unsigned char *buffer2, const unsigned int samples) = 0;
+
+    /** \brief Flushes the encoder and writes the last data and stream trailers to the device. The
+     *         encoder can't be used after this call. Returns false on error.
+     *
+     */
+    virtual bool finish() = 0;
+
+    /** \brief Returns the extension of the output files, without the dot.
+     *
+     */
+    virtual QString extension() const = 0;
+
+    /** \brief Returns the sample format the encoder consumes without converting it.
+     *
+     */
+    virtual Sample_format preferred_format() const = 0;
+
+    /** \brief Returns true if the output files are tagged by the worker with an ID3v2 tag and false
+     *         if the tags are written by the encoder.
+     *
+     */
+    virtual bool usesID3Tags() const = 0;
+
+    /** \brief Returns the description of the last error.
+     *
+     */
+    const QString &error() const
+    { return m_error; }
+
+    /** \brief Returns a new encoder for the given profile.
+     * \param[in] profile encoding settings.
+     * \param[in] quality LAME algorithm quality in [0-9].
+     *
+     */
+    static std::unique_ptr<Encoder> create(const Utils::OutputProfile &profile, const int quality);
+
+    /** \brief Encodes some seconds of synthetic stereo audio with each one of the given profiles and
+     *         returns the speed and size of each encoder on this computer.
+     * \param[in] profiles encoding settings to benchmark.
+     * \param[in] quality LAME algorithm quality in [0-9].
+     * \param[in] seconds duration of the encoded audio in seconds.
+     *
+     */
+    static QList<Benchmark> benchmark(const QList<Utils::OutputProfile> &profiles, const int quality, const int seconds);
+
+  protected:
+    QString m_error; /** description of the last error. */
+};
+
+#endif // ENCODER_H_
@@ -0,0 +1,214 @@
+/*
+ File: FileClassifier.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "FileClassifier.h"
+#include "Utils.h"
+
+// Qt
+#include <QFile>
+#include <QMutexLocker>
+
+// libopenmpt
+#include <libopenmpt/libopenmpt.hpp>
+
+// C++
+#include <string_view>
+
+QMutex                               FileClassifier::s_mutex;
+QHash<QString, FileClassifier::Kind> FileClassifier::s_kinds;
+
+namespace
+{
+  /** \struct Signature
+   * \brief Bytes that identify a file format, at the given offsets of the file.
+   *
+   */
+  struct Signature
+  {
+    int                  offset;        /** offset of the magic bytes.                        */
+    std::string_view     magic;         /** magic bytes.                                      */
+    int                  second_offset; /** offset of the second magic bytes.                 */
+    std::string_view     second_magic;  /** second magic bytes, empty if not needed.          */
+    FileClassifier::Kind kind;          /** kind of the files with this signature.            */
+  };
+
+  using Kind = FileClassifier::Kind;
+
+  // checked in order, the more specific signatures of a container go first. the ASF header GUID is
+  // the one of the wma files.
+  constexpr Signature SIGNATURES[] =
+  {
+    { 0, "fLaC",                                                   0, {},       Kind::AUDIO },
+    { 0, "RIFF",                                                   8, "WAVE",   Kind::PCM   },
+    { 0, "RIFF",                                                   8, "AVI ",   Kind::VIDEO },
+    { 0, "FORM",                                                   8, "AIFF",   Kind::PCM   },
+    { 0, "FORM",                                                   8, "AIFC",   Kind::PCM   },
+    { 0, "OggS",                                                  29, "theora", Kind::VIDEO },
+    { 0, "OggS",                                                   0, {},       Kind::AUDIO },
+    { 4, "ftyp",                                                   8, "M4A ",   Kind::AUDIO },
+    { 4, "ftyp",                                                   8, "M4B ",   Kind::AUDIO },
+    { 4, "ftyp",                                                   0, {},       Kind::VIDEO },
+    { 0, std::string_view("\x1A\x45\xDF\xA3", 4),                  0, {},       Kind::VIDEO },
+    { 0, std::string_view("\x30\x26\xB2\x75\x8E\x66\xCF\x11", 8),  0, {},       Kind::AUDIO },
+    { 0, "MAC ",                                                   0, {},       Kind::AUDIO },
+    { 0, "wvpk",                                                   0, {},       Kind::AUDIO },
+    { 0, "Creative Voice File",                                    0, {},       Kind::AUDIO }
+  };
+
+  /** \brief Returns true if the header has the given bytes at the given offset.
+   * \param[in] header first bytes of the file.
+   * \param[in] offset offset of the bytes.
+   * \param[in] magic bytes to check.
+   *
+   */
+  bool matches(const QByteArray &header, const int offset, const std::string_view &magic)
+  {
+    if(header.size() < offset + static_cast<int>(magic.size())) return false;
+
+    return std::string_view(header.constData() + offset, magic.size()) == magic;
+  }
+}
+
+//-----------------------------------------------------------------
+FileClassifier::Kind FileClassifier::classify(const QFileInfo &file)
+{
+  const auto file_name = file.absoluteFilePath();
+
+  {
+    QMutexLocker lock(&s_mutex);
+
+    const auto it = s_kinds.constFind(file_name);
+    if(it != s_kinds.constEnd()) return it.value();
+  }
+
+  auto kind = content_kind(file);
+  if(kind == Kind::UNKNOWN)
+  {
+    kind = extension_kind(file);
+  }
+
+  QMutexLocker lock(&s_mutex);
+  s_kinds.insert(file_name, kind);
+
+  return kind;
+}
+
+//-----------------------------------------------------------------
+FileClassifier::Kind FileClassifier::extension_kind(const QFileInfo &file)
+{
+  static const QHash<QString, Kind> EXTENSIONS = []()
+  {
+    QHash<QString, Kind> extensions;
+
+    // filters are "*.extension".
+    for(const auto &filter: Utils::WAVE_FILE_EXTENSIONS)   extensions.insert(filter.mid(2), Kind::AUDIO);
+    for(const auto &filter: Utils::MOVIE_FILE_EXTENSIONS)  extensions.insert(filter.mid(2), Kind::VIDEO);
+    for(const auto &filter: Utils::MODULE_FILE_EXTENSIONS) extensions.insert(filter.mid(2), Kind::MODULE);
+
+    extensions.insert("mp3", Kind::MP3);
+    extensions.insert("wav", Kind::PCM);
+    extensions.insert("aiff", Kind::PCM);
+    extensions.insert("aif", Kind::PCM);
+    extensions.insert("aifc", Kind::PCM);
+
+    return extensions;
+  }();
+
+  return EXTENSIONS.value(file.suffix().toLower(), Kind::UNKNOWN);
+}
+
+//-----------------------------------------------------------------
+void FileClassifier::clear()
+{
+  QMutexLocker lock(&s_mutex);
+  s_kinds.clear();
+}
+
+//-----------------------------------------------------------------
+FileClassifier::Kind FileClassifier::signature_kind(const QByteArray &header)
+{
+  for(const auto &signature: SIGNATURES)
+  {
+    if(matches(header, signature.offset, signature.magic) &&
+      (signature.second_magic.empty() || matches(header, signature.second_offset, signature.second_magic)))
+    {
+      return signature.kind;
+    }
+  }
+
+  // MPEG audio frame sync, layer III is MP3 and layer bits 00 are AAC ADTS.
+  if(header.size() >= 2 && static_cast<unsigned char>(header.at(0)) == 0xFF && (header.at(1) & 0xE0) == 0xE0)
+  {
+    const auto layer = (header.at(1) & 0x06) >> 1;
+    if(layer == 1) return Kind::MP3;
+    if(layer == 0) return Kind::AUDIO;
+  }
+
+  return Kind::UNKNOWN;
+}
+
+//-----------------------------------------------------------------
+FileClassifier::Kind FileClassifier::content_kind(const QFileInfo &file)
+{
+  QFile source(file.absoluteFilePath());
+  if(!source.open(QIODevice::ReadOnly)) return Kind::UNKNOWN;
+
+  auto header = source.read(HEADER_SIZE);
+
+  // an ID3v2 tag can be in front of FLAC, APE or WAV data too, the format is the one after the tag.
+  bool has_tag = false;
+  if(header.size() >= ID3V2_HEADER_SIZE && header.startsWith("ID3"))
+  {
+    const auto bytes = reinterpret_cast<const unsigned char *>(header.constData());
+
+    // the size is a syncsafe integer, without the header and the footer.
+    long long tag_size = ID3V2_HEADER_SIZE + (((bytes[6] & 0x7F) << 21) | ((bytes[7] & 0x7F) << 14) | ((bytes[8] & 0x7F) << 7) | (bytes[9] & 0x7F));
+    if(bytes[5] & 0x10) tag_size += ID3V2_HEADER_SIZE;
+
+    has_tag = true;
+    header  = source.seek(tag_size) ? source.read(HEADER_SIZE) : QByteArray();
+  }
+
+  // unrecognized data after a tag is classified by the extension.
+  auto kind = signature_kind(header);
+  if(kind == Kind::UNKNOWN && !has_tag && header.size() == HEADER_SIZE)
+  {
+    // module formats have their signatures all over the header, libopenmpt knows where to look.
+    const auto size = static_cast<qint64>(openmpt::probe_file_header_get_recommended_size());
+    if(size > header.size())
+    {
+      header.append(source.read(size - header.size()));
+    }
+
+    const auto result = openmpt::probe_file_header(openmpt::probe_file_header_flags_default,
+                                                   reinterpret_cast<const std::uint8_t *>(header.constData()),
+                                                   static_cast<std::size_t>(header.size()),
+                                                   static_cast<std::uint64_t>(source.size()));
+
+    if(result == openmpt::probe_file_header_result_success)
+    {
+      kind = Kind::MODULE;
+    }
+  }
+
+  source.close();
+
+  return kind;
+}
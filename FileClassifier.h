@@ -0,0 +1,91 @@
+/*
+ File: FileClassifier.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILE_CLASSIFIER_H_
+#define FILE_CLASSIFIER_H_
+
+// Qt
+#include <QByteArray>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/** \class FileClassifier
+ * \brief Identifies the kind of job of a file by the signature of its contents, so misnamed files
+ *        get the right worker. The files are read only once, the result is kept until cleared.
+ *
+ */
+class FileClassifier
+{
+  public:
+    /** \brief Kind of job of a file.
+     *
+     */
+    enum class Kind: char
+    {
+      UNKNOWN = 0, /** not a file to transcode.                */
+      MP3,         /** MPEG layer III audio.                   */
+      PCM,         /** uncompressed audio, wav or aiff/aifc.   */
+      AUDIO,       /** any other audio format libav can read.  */
+      VIDEO,       /** video file, only the audio is used.     */
+      MODULE       /** module file, rendered by libopenmpt.    */
+    };
+
+    /** \brief Returns the kind of the file by its contents, or by its extension if the contents
+     *         aren't recognized or the file can't be read.
+     * \param[in] file file QFileInfo struct.
+     *
+     */
+    static Kind classify(const QFileInfo &file);
+
+    /** \brief Returns the kind of the file by its extension only, the file isn't read.
+     * \param[in] file file QFileInfo struct.
+     *
+     */
+    static Kind extension_kind(const QFileInfo &file);
+
+    /** \brief Removes all the results.
+     *
+     */
+    static void clear();
+
+  private:
+    /** \brief Returns the kind of the file by the signature of the given header, or UNKNOWN if it
+     *         doesn't match any of the signatures.
+     * \param[in] header first bytes of the file.
+     *
+     */
+    static Kind signature_kind(const QByteArray &header);
+
+    /** \brief Reads the beginning of the file, skipping the ID3v2 tag if there is one, and returns its
+     *         kind, or UNKNOWN if the contents aren't recognized.
+     * \param[in] file file QFileInfo struct.
+     *
+     */
+    static Kind content_kind(const QFileInfo &file);
+
+    static const int HEADER_SIZE       = 64; /** bytes read to check the signatures. */
+    static const int ID3V2_HEADER_SIZE = 10; /** size of the ID3v2 header and footer. */
+
+    static QMutex               s_mutex; /** protects the results.          */
+    static QHash<QString, Kind> s_kinds; /** kinds of the classified files. */
+};
+
+#endif // FILE_CLASSIFIER_H_
@@ -0,0 +1,254 @@
+/*
+ File: FolderWatcher.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "FolderWatcher.h"
+#include "DirectoryScanner.h"
+#include "LibraryIndex.h"
+
+// Qt
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
+// C++
+#include <utility>
+
+//-----------------------------------------------------------------
+FolderWatcher::FolderWatcher(const Utils::TranscoderConfiguration &configuration, QObject *parent)
+: QObject     {parent}
+, m_started   {QDateTime::currentMSecsSinceEpoch()}
+, m_extensions{DirectoryScanner::media_extensions(configuration)}
+, m_excluded  {DirectoryScanner::output_directories(configuration)}
+, m_folders   {configuration.createM3Ufiles()}
+, m_skip      {configuration.skipUnchangedFiles()}
+{
+  m_clock.start();
+
+  m_timer.setInterval(CHECK_INTERVAL);
+
+  connect(&m_watcher, SIGNAL(directoryChanged(const QString &)),
+          this,       SLOT(on_directory_changed(const QString &)));
+
+  connect(&m_timer,   SIGNAL(timeout()),
+          this,       SLOT(check()));
+}
+
+//-----------------------------------------------------------------
+void FolderWatcher::watch(const QStringList &directories)
+{
+  // the index keeps the separator at the end, the subdirectories of the listings don't have it.
+  QStringList paths;
+  for(const auto &directory: directories)
+  {
+    if(QFileInfo(directory).isDir()) paths << QDir(directory).absolutePath();
+  }
+
+  if(!paths.isEmpty())
+  {
+    m_watcher.addPaths(paths);
+  }
+}
+
+//-----------------------------------------------------------------
+void FolderWatcher::stop()
+{
+  m_timer.stop();
+
+  const auto directories = m_watcher.directories();
+  if(!directories.isEmpty())
+  {
+    m_watcher.removePaths(directories);
+  }
+
+  m_changed.clear();
+  m_candidates.clear();
+}
+
+//-----------------------------------------------------------------
+void FolderWatcher::on_directory_changed(const QString &directory)
+{
+  const auto path = QDir::fromNativeSeparators(directory);
+
+  // the changes come in bursts while the files are copied, the directory is listed once per check.
+  m_changed.insert(path.endsWith('/') ? path : path + '/');
+
+  if(!m_timer.isActive())
+  {
+    m_timer.start();
+  }
+}
+
+//-----------------------------------------------------------------
+void FolderWatcher::check()
+{
+  const auto changed = m_changed;
+  m_changed.clear();
+
+  for(const auto &directory: changed)
+  {
+    list(directory);
+  }
+
+  QList<QFileInfo> files;
+  QSet<QString> folders;
+  const auto now = m_clock.elapsed();
+
+  for(auto it = m_candidates.begin(); it != m_candidates.end();)
+  {
+    const QFileInfo info(it.key());
+    if(!info.exists())
+    {
+      it = m_candidates.erase(it);
+      continue;
+    }
+
+    const DirectoryIndex::Stamp stamp(info.size(), info.lastModified().toMSecsSinceEpoch());
+    if(stamp.size != it->stamp.size || stamp.modified != it->stamp.modified)
+    {
+      it->stamp = stamp;
+      it->seen  = now;
+      ++it;
+      continue;
+    }
+
+    if(now - it->seen < SETTLE_TIME)
+    {
+      ++it;
+      continue;
+    }
+
+    // unchanged for a while, the file has been completely written.
+    m_scheduled.insert(it.key(), stamp);
+
+    const auto directory = info.absolutePath() + '/';
+
+    // a worker can finish writing an output after the directory was listed.
+    if(DirectoryIndex::outputs(directory).contains(info.fileName(), Qt::CaseInsensitive))
+    {
+      it = m_candidates.erase(it);
+      continue;
+    }
+
+    QSet<QString> outputs;
+    if(m_skip)
+    {
+      for(const auto &output: DirectoryIndex::outputs(directory))
+      {
+        outputs.insert(output.toLower());
+      }
+    }
+
+    if(!m_skip || !LibraryIndex::up_to_date(info, directory, outputs))
+    {
+      files << info;
+
+      if(m_folders) folders.insert(info.absolutePath());
+    }
+
+    it = m_candidates.erase(it);
+  }
+
+  if(!files.isEmpty())
+  {
+    emit files_found(files);
+  }
+
+  if(!folders.isEmpty())
+  {
+    QList<QFileInfo> infos;
+    for(const auto &folder: std::as_const(folders))
+    {
+      infos << QFileInfo(folder);
+    }
+
+    emit folders_found(infos);
+  }
+
+  if(m_changed.isEmpty() && m_candidates.isEmpty())
+  {
+    m_timer.stop();
+  }
+}
+
+//-----------------------------------------------------------------
+void FolderWatcher::list(const QString &directory)
+{
+  const auto known     = DirectoryIndex::media(directory);
+  const auto outputs   = DirectoryIndex::outputs(directory);
+  const auto durations = DirectoryIndex::durations(directory);
+
+  DirectoryIndex::Directory contents;
+  QList<QFileInfo> media;
+  QStringList subdirectories;
+
+  DirectoryScanner::list_directory(directory, m_extensions, m_excluded, contents, media, subdirectories);
+
+  // the listing only has the MP3 outputs, the ones of other codecs written by the workers are kept.
+  for(const auto &output: outputs)
+  {
+    if(!contents.outputs.contains(output, Qt::CaseInsensitive) && QFile::exists(directory + output))
+    {
+      contents.outputs << output;
+    }
+  }
+
+  // the durations of the outputs written by the workers are kept for the playlists.
+  contents.durations = durations;
+  DirectoryIndex::add_directory(directory, contents);
+
+  const auto now = m_clock.elapsed();
+
+  for(const auto &info: std::as_const(media))
+  {
+    const auto name = info.fileName();
+    const DirectoryIndex::Stamp stamp(info.size(), info.lastModified().toMSecsSinceEpoch());
+
+    // the MP3 files of the scan and the files written by the workers, whatever their codec, aren't new sources.
+    if(outputs.contains(name, Qt::CaseInsensitive)) continue;
+
+    // a file of the scan is transcoded again only if it's modified.
+    if(info.suffix().compare("mp3", Qt::CaseInsensitive) != 0 && known.contains(name, Qt::CaseInsensitive) && stamp.modified < m_started) continue;
+
+    const auto path      = info.absoluteFilePath();
+    const auto scheduled = m_scheduled.constFind(path);
+    if(scheduled != m_scheduled.constEnd() && scheduled->size == stamp.size && scheduled->modified == stamp.modified) continue;
+
+    auto candidate = m_candidates.find(path);
+    if(candidate == m_candidates.end())
+    {
+      m_candidates.insert(path, Candidate{stamp, now});
+    }
+    else if(candidate->stamp.size != stamp.size || candidate->stamp.modified != stamp.modified)
+    {
+      candidate->stamp = stamp;
+      candidate->seen  = now;
+    }
+  }
+
+  // a new folder can arrive with its subfolders, they aren't in the index. the ones already watched
+  // aren't added again.
+  for(const auto &subdirectory: std::as_const(subdirectories))
+  {
+    if(m_watcher.addPath(subdirectory))
+    {
+      list(subdirectory + '/');
+    }
+  }
+}
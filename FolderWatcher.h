@@ -0,0 +1,136 @@
+/*
+ File: FolderWatcher.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FOLDER_WATCHER_H_
+#define FOLDER_WATCHER_H_
+
+// Project
+#include "Utils.h"
+#include "DirectoryIndex.h"
+
+// Qt
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+/** \class FolderWatcher
+ * \brief Watches the directories of the scan after it has ended and sends the files to transcode that
+ *        are added or modified, once they haven't changed for a while. Only the directories that change
+ *        are listed again and their contents are updated in the DirectoryIndex.
+ *
+ */
+class FolderWatcher
+: public QObject
+{
+    Q_OBJECT
+  public:
+    /** \brief FolderWatcher class constructor.
+     * \param[in] configuration configuration struct reference.
+     * \param[in] parent raw pointer of the object parent of this one.
+     *
+     */
+    explicit FolderWatcher(const Utils::TranscoderConfiguration &configuration, QObject *parent = nullptr);
+
+    /** \brief FolderWatcher class virtual destructor.
+     *
+     */
+    virtual ~FolderWatcher()
+    {};
+
+    /** \brief Starts watching the given directories.
+     * \param[in] directories directory paths.
+     *
+     */
+    void watch(const QStringList &directories);
+
+    /** \brief Stops watching the directories, the files being written are discarded.
+     *
+     */
+    void stop();
+
+    /** \brief Returns the number of directories being watched.
+     *
+     */
+    int watched_directories() const
+    { return m_watcher.directories().size(); }
+
+  signals:
+    /** \brief Sends a batch of files to transcode.
+     * \param[in] files files information.
+     *
+     */
+    void files_found(const QList<QFileInfo> &files);
+
+    /** \brief Sends a batch of folders to create playlists.
+     * \param[in] folders folders information.
+     *
+     */
+    void folders_found(const QList<QFileInfo> &folders);
+
+  private slots:
+    /** \brief Marks the directory to be listed in the next check.
+     * \param[in] directory directory path.
+     *
+     */
+    void on_directory_changed(const QString &directory);
+
+    /** \brief Lists the changed directories and sends the files that have been completely written.
+     *
+     */
+    void check();
+
+  private:
+    static const int CHECK_INTERVAL = 1000; /** milliseconds between checks while there are changes.      */
+    static const int SETTLE_TIME    = 3000; /** milliseconds a file must stay unchanged to be transcoded. */
+
+    /** \struct Candidate
+     * \brief File that could still be being written.
+     *
+     */
+    struct Candidate
+    {
+      DirectoryIndex::Stamp stamp; /** last size and time of the file.                */
+      qint64                seen;  /** time the stamp was first seen, in milliseconds. */
+    };
+
+    /** \brief Lists the directory, updates its contents in the index and adds the new or modified files
+     *         to the candidates. The new subdirectories are watched and listed too.
+     * \param[in] directory directory path, with the separator at the end.
+     *
+     */
+    void list(const QString &directory);
+
+    QFileSystemWatcher                    m_watcher;    /** watcher of the directories.                              */
+    QTimer                                m_timer;      /** timer of the checks.                                     */
+    QElapsedTimer                         m_clock;      /** time since the watch started.                            */
+    const qint64                          m_started;    /** start of the watch, in milliseconds since the epoch.     */
+    const QSet<QString>                   m_extensions; /** extensions of the files to transcode, in lower case.     */
+    const QSet<QString>                   m_excluded;   /** directories of the additional outputs, in lower case.    */
+    const bool                            m_folders;    /** true to send the folders with playlist work.             */
+    const bool                            m_skip;       /** true to skip the files in the library index.             */
+    QSet<QString>                         m_changed;    /** directories changed since the last check.                */
+    QHash<QString, Candidate>             m_candidates; /** new or modified files that could still be being written. */
+    QHash<QString, DirectoryIndex::Stamp> m_scheduled;  /** stamps of the files already sent to transcode.           */
+};
+
+#endif // FOLDER_WATCHER_H_
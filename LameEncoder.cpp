@@ -0,0 +1,222 @@
+/*
+ File: LameEncoder.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "LameEncoder.h"
+
+// Qt
+#include <QIODevice>
+
+// C++
+#include <algorithm>
+
+//-----------------------------------------------------------------
+LameEncoder::LameEncoder(const int quality)
+: m_quality        {quality}
+, m_gfp            {nullptr}
+, m_device         {nullptr}
+, m_header_position{0}
+, m_mp3_buffer     (MP3_BUFFER_SIZE, 0)
+{
+}
+
+//-----------------------------------------------------------------
+LameEncoder::~LameEncoder()
+{
+  if(m_gfp)
+  {
+    lame_close(m_gfp);
+  }
+}
+
+//-----------------------------------------------------------------
+bool LameEncoder::init(const Utils::OutputProfile &profile, const Input &input, const QMap<QString, QString> &tags, QIODevice *device)
+{
+  Q_ASSERT(!m_gfp && device);
+
+  m_input           = input;
+  m_device          = device;
+  m_header_position = device->pos();
+
+  m_gfp = lame_init();
+
+  lame_set_num_channels (m_gfp, input.channels);
+  lame_set_in_samplerate(m_gfp, input.samplerate);
+  lame_set_quality      (m_gfp, m_quality);
+  lame_set_mode         (m_gfp, input.channels == 2 ? MPEG_mode_e::STEREO : MPEG_mode_e::MONO);
+  lame_set_bWriteVbrTag (m_gfp, 1);
+  lame_set_copyright    (m_gfp, 0);
+  lame_set_original     (m_gfp, 0);
+
+  switch(profile.mode)
+  {
+    case Utils::EncodingMode::VBR:
+      lame_set_VBR        (m_gfp, vbr_default);
+      lame_set_VBR_quality(m_gfp, profile.vbr_quality);
+      break;
+    case Utils::EncodingMode::ABR:
+      lame_set_VBR                  (m_gfp, vbr_abr);
+      lame_set_VBR_mean_bitrate_kbps(m_gfp, profile.bitrate);
+      break;
+    case Utils::EncodingMode::CBR:
+    default:
+      lame_set_VBR  (m_gfp, vbr_off);
+      lame_set_brate(m_gfp, profile.bitrate);
+      break;
+  }
+
+  if(0 != lame_init_params(m_gfp))
+  {
+    m_error = QString("Error in LAME library init stage");
+    return false;
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool LameEncoder::encode(unsigned char *buffer_L, unsigned char *buffer_R, const unsigned int buffer_length)
+{
+  Q_ASSERT(m_gfp);
+
+  // worst case size from the lame documentation.
+  const auto required = (5 * static_cast<std::size_t>(buffer_length)) / 4 + 7200;
+  if(m_mp3_buffer.size() < required)
+  {
+    m_mp3_buffer.resize(required);
+  }
+
+  int output_bytes = 0;
+
+  switch(m_input.format)
+  {
+    case Sample_format::SIGNED_16:
+      output_bytes = lame_encode_buffer_interleaved(m_gfp, reinterpret_cast<short int *>(buffer_L), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      break;
+    case Sample_format::FLOAT:
+      output_bytes = lame_encode_buffer_interleaved_ieee_float(m_gfp, reinterpret_cast<const float *>(buffer_L), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      break;
+    case Sample_format::DOUBLE:
+      output_bytes = lame_encode_buffer_interleaved_ieee_double(m_gfp, reinterpret_cast<const double *>(buffer_L), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      break;
+    case Sample_format::SIGNED_16_PLANAR:
+      output_bytes = lame_encode_buffer(m_gfp, reinterpret_cast<const short int *>(buffer_L), reinterpret_cast<const short int *>(buffer_R), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      break;
+    case Sample_format::SIGNED_32_PLANAR:
+      output_bytes = lame_encode_buffer_long2(m_gfp, reinterpret_cast<const long int *>(buffer_L), reinterpret_cast<const long int *>(buffer_R), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      break;
+    case Sample_format::FLOAT_PLANAR:
+      output_bytes = lame_encode_buffer_ieee_float(m_gfp, reinterpret_cast<const float *>(buffer_L), reinterpret_cast<const float *>(buffer_R), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      break;
+    case Sample_format::DOUBLE_PLANAR:
+      output_bytes = lame_encode_buffer_ieee_double(m_gfp, reinterpret_cast<const double *>(buffer_L), reinterpret_cast<const double *>(buffer_R), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      break;
+    case Sample_format::SIGNED_32: // not natively supported by lame, we need to make it planar. it's a common sample format in flac files.
+      {
+        // kept between calls, the blocks can be too big for the stack.
+        m_planar_L.resize(std::max<std::size_t>(m_planar_L.size(), buffer_length));
+        m_planar_R.resize(std::max<std::size_t>(m_planar_R.size(), buffer_length));
+        auto L_pointer = reinterpret_cast<long int *>(buffer_L);
+
+        for(unsigned long i = 0; i < buffer_length * 2; i += 2)
+        {
+          m_planar_L[i/2] = L_pointer[i];
+          m_planar_R[i/2] = L_pointer[i+1];
+        }
+        output_bytes = lame_encode_buffer_long2(m_gfp, m_planar_L.data(), m_planar_R.data(), buffer_length, m_mp3_buffer.data(), m_mp3_buffer.size());
+      }
+      break;
+      // Unsupported formats
+    default:
+    case Sample_format::UNSIGNED_8:
+    case Sample_format::UNSIGNED_8_PLANAR:
+      m_error = QString("Unsupported sample format");
+      return false;
+      break;
+  }
+
+  if (output_bytes < 0)
+  {
+    switch (output_bytes)
+    {
+      case -1:
+        m_error = QString("Error in LAME code stage, mp3 buffer was too small.");
+        break;
+      case -2:
+        m_error = QString("Error in LAME code stage, malloc() problem.");
+        break;
+      case -3:
+        m_error = QString("Error in LAME code stage, lame_init_params() not called.");
+        break;
+      case -4:
+        m_error = QString("Error in LAME code stage, psycho acoustic problems.");
+        break;
+      default:
+        Q_ASSERT(false);
+    }
+
+    return false;
+  }
+
+  return write(output_bytes);
+}
+
+//-----------------------------------------------------------------
+bool LameEncoder::finish()
+{
+  Q_ASSERT(m_gfp);
+
+  const auto flush_bytes = lame_encode_flush(m_gfp, m_mp3_buffer.data(), m_mp3_buffer.size());
+  const auto result = (flush_bytes >= 0) && write(flush_bytes) && write_lame_tag_frame();
+
+  lame_close(m_gfp);
+  m_gfp = nullptr;
+
+  return result;
+}
+
+//-----------------------------------------------------------------
+bool LameEncoder::write(const int size)
+{
+  if(size > 0 && m_device->write(reinterpret_cast<char *>(m_mp3_buffer.data()), size) != size)
+  {
+    m_error = QString("Error writing to the destination. Error is: %1").arg(m_device->errorString());
+    return false;
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool LameEncoder::write_lame_tag_frame()
+{
+  // the first frame written by lame is empty, it's overwritten with the Xing/LAME header.
+  const auto size = lame_get_lametag_frame(m_gfp, m_mp3_buffer.data(), m_mp3_buffer.size());
+  if(size == 0 || size > m_mp3_buffer.size()) return true;
+
+  const auto position = m_device->pos();
+
+  if(!m_device->seek(m_header_position) || m_device->write(reinterpret_cast<char *>(m_mp3_buffer.data()), size) != static_cast<qint64>(size) || !m_device->seek(position))
+  {
+    m_error = QString("Error writing the LAME header. Error is: %1").arg(m_device->errorString());
+    return false;
+  }
+
+  return true;
+}
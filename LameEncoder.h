@@ -0,0 +1,91 @@
+/*
+ File: LameEncoder.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LAME_ENCODER_H_
+#define LAME_ENCODER_H_
+
+// Project
+#include "Encoder.h"
+
+// C++
+#include <vector>
+
+// Lame
+#include <lame.h>
+
+/** \class LameEncoder
+ * \brief Encodes MP3 streams with the LAME library.
+ *
+ */
+class LameEncoder
+: public Encoder
+{
+  public:
+    /** \brief LameEncoder class constructor.
+     * \param[in] quality LAME algorithm quality in [0-9].
+     *
+     */
+    explicit LameEncoder(const int quality);
+
+    /** \brief LameEncoder class virtual destructor.
+     *
+     */
+    virtual ~LameEncoder();
+
+    virtual bool init(const Utils::OutputProfile &profile, const Input &input, const QMap<QString, QString> &tags, QIODevice *device) override;
+
+    virtual bool encode(unsigned char *buffer1, unsigned char *buffer2, const unsigned int samples) override;
+
+    virtual bool finish() override;
+
+    virtual QString extension() const override
+    { return QString("mp3"); }
+
+    virtual Sample_format preferred_format() const override
+    { return Sample_format::FLOAT_PLANAR; }
+
+    virtual bool usesID3Tags() const override
+    { return true; }
+
+  private:
+    static const int MP3_BUFFER_SIZE = 33920; /** minimum buffer size used for encoding to MP3. */
+
+    /** \brief Writes the given bytes of the mp3 buffer to the device. Returns false on error.
+     * \param[in] size number of bytes.
+     *
+     */
+    bool write(const int size);
+
+    /** \brief Writes the Xing/LAME header frame with the duration and seek table in place of the
+     *         first frame of the stream.
+     *
+     */
+    bool write_lame_tag_frame();
+
+    const int                  m_quality;         /** lame algorithm quality.                       */
+    Input                      m_input;           /** format of the samples.                        */
+    lame_global_flags         *m_gfp;             /** lame encoder global flags.                    */
+    QIODevice                 *m_device;          /** output device.                                */
+    long long                  m_header_position; /** position of the first frame in the device.    */
+    std::vector<unsigned char> m_mp3_buffer;      /** encoding buffer, grows with the input blocks. */
+    std::vector<long>          m_planar_L;        /** left samples of interleaved 32 bits input.    */
+    std::vector<long>          m_planar_R;        /** right samples of interleaved 32 bits input.   */
+};
+
+#endif // LAME_ENCODER_H_
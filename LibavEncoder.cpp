@@ -0,0 +1,393 @@
+/*
+ File: LibavEncoder.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "LibavEncoder.h"
+
+// Qt
+#include <QIODevice>
+
+// C++
+#include <algorithm>
+
+//-----------------------------------------------------------------
+LibavEncoder::LibavEncoder(const Utils::Codec codec)
+: m_codec           {codec}
+, m_device          {nullptr}
+, m_format_context  {nullptr}
+, m_io_context      {nullptr}
+, m_codec_context   {nullptr}
+, m_stream          {nullptr}
+, m_resampler       {nullptr}
+, m_fifo            {nullptr}
+, m_converted       {nullptr}
+, m_frame           {nullptr}
+, m_packet          {nullptr}
+, m_frame_size      {0}
+, m_small_last_frame{false}
+, m_pts             {0}
+{
+  switch(m_codec)
+  {
+    case Utils::Codec::AAC:    m_extension = "m4a";  break;
+    case Utils::Codec::OPUS:   m_extension = "opus"; break;
+    case Utils::Codec::VORBIS: m_extension = "ogg";  break;
+    default:
+      break;
+  }
+}
+
+//-----------------------------------------------------------------
+LibavEncoder::~LibavEncoder()
+{
+  release();
+}
+
+//-----------------------------------------------------------------
+bool LibavEncoder::init(const Utils::OutputProfile &profile, const Input &input, const QMap<QString, QString> &tags, QIODevice *device)
+{
+  Q_ASSERT(!m_codec_context && device);
+
+  AVCodecID codec_id;
+  const char *muxer = nullptr;
+
+  switch(m_codec)
+  {
+    case Utils::Codec::AAC:
+      codec_id = AV_CODEC_ID_AAC;
+      muxer    = "ipod";
+      break;
+    case Utils::Codec::OPUS:
+      codec_id = AV_CODEC_ID_OPUS;
+      muxer    = "opus";
+      break;
+    case Utils::Codec::VORBIS:
+      codec_id = AV_CODEC_ID_VORBIS;
+      muxer    = "ogg";
+      break;
+    default:
+      m_error = QString("Codec not supported by the libav encoder");
+      return false;
+  }
+
+  const auto input_format = sample_format(input.format);
+  if(input_format == AV_SAMPLE_FMT_NONE)
+  {
+    m_error = QString("Unsupported sample format");
+    return false;
+  }
+
+  const auto codec = avcodec_find_encoder(codec_id);
+  if(!codec)
+  {
+    m_error = QString("There isn't an encoder for %1 in libav").arg(profile.name());
+    return false;
+  }
+
+  m_device        = device;
+  m_codec_context = avcodec_alloc_context3(codec);
+
+  // the first sample format is the preferred one, any sample rate is valid if there isn't a list.
+  const void *configuration = nullptr;
+  int count = 0;
+
+  m_codec_context->sample_fmt = AV_SAMPLE_FMT_FLTP;
+  if(avcodec_get_supported_config(m_codec_context, codec, AV_CODEC_CONFIG_SAMPLE_FORMAT, 0, &configuration, &count) >= 0 && count > 0)
+  {
+    m_codec_context->sample_fmt = reinterpret_cast<const AVSampleFormat *>(configuration)[0];
+  }
+
+  m_codec_context->sample_rate = input.samplerate;
+  if(avcodec_get_supported_config(m_codec_context, codec, AV_CODEC_CONFIG_SAMPLE_RATE, 0, &configuration, &count) >= 0 && count > 0)
+  {
+    // the lowest supported rate over the input one, or the highest if there isn't one.
+    const auto rates = reinterpret_cast<const int *>(configuration);
+    int selected = 0, highest = 0;
+    for(int i = 0; i < count; ++i)
+    {
+      highest = std::max(highest, rates[i]);
+      if(rates[i] >= input.samplerate && (selected == 0 || rates[i] < selected)) selected = rates[i];
+    }
+    m_codec_context->sample_rate = (selected != 0) ? selected : highest;
+  }
+
+  av_channel_layout_default(&m_codec_context->ch_layout, input.channels);
+  m_codec_context->bit_rate              = profile.bitrate * 1000LL;
+  m_codec_context->time_base             = AVRational{1, m_codec_context->sample_rate};
+  m_codec_context->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+  auto code = avformat_alloc_output_context2(&m_format_context, nullptr, muxer, nullptr);
+  if(code < 0) return set_error(QString("Couldn't create the %1 muxer").arg(muxer), code);
+
+  if(m_format_context->oformat->flags & AVFMT_GLOBALHEADER)
+  {
+    m_codec_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+
+  code = avcodec_open2(m_codec_context, codec, nullptr);
+  if(code < 0) return set_error(QString("Couldn't open the %1 encoder").arg(codec->name), code);
+
+  m_stream = avformat_new_stream(m_format_context, nullptr);
+  avcodec_parameters_from_context(m_stream->codecpar, m_codec_context);
+  m_stream->time_base = m_codec_context->time_base;
+
+  auto buffer  = reinterpret_cast<unsigned char *>(av_malloc(IO_BUFFER_SIZE));
+  m_io_context = avio_alloc_context(buffer, IO_BUFFER_SIZE, 1, this, nullptr, write_packet, seek);
+  m_format_context->pb     = m_io_context;
+  m_format_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+  for(auto it = tags.cbegin(); it != tags.cend(); ++it)
+  {
+    av_dict_set(&m_format_context->metadata, it.key().toUtf8().constData(), it.value().toUtf8().constData(), 0);
+    av_dict_set(&m_stream->metadata, it.key().toUtf8().constData(), it.value().toUtf8().constData(), 0);
+  }
+
+  code = avformat_write_header(m_format_context, nullptr);
+  if(code < 0) return set_error(QString("Couldn't write the %1 header").arg(muxer), code);
+
+  AVChannelLayout input_layout;
+  av_channel_layout_default(&input_layout, input.channels);
+
+  code = swr_alloc_set_opts2(&m_resampler, &m_codec_context->ch_layout, m_codec_context->sample_fmt, m_codec_context->sample_rate,
+                             &input_layout, input_format, input.samplerate, 0, nullptr);
+  av_channel_layout_uninit(&input_layout);
+
+  if(code < 0 || (code = swr_init(m_resampler)) < 0) return set_error(QString("Couldn't create the sample converter"), code);
+
+  const auto variable_size = (codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE) != 0;
+  m_frame_size       = (m_codec_context->frame_size > 0 && !variable_size) ? m_codec_context->frame_size : 1024;
+  m_small_last_frame = variable_size || (codec->capabilities & AV_CODEC_CAP_SMALL_LAST_FRAME) != 0;
+
+  m_fifo      = av_audio_fifo_alloc(m_codec_context->sample_fmt, input.channels, 2 * m_frame_size);
+  m_converted = av_frame_alloc();
+  m_frame     = av_frame_alloc();
+  m_packet    = av_packet_alloc();
+  m_pts       = 0;
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool LibavEncoder::encode(unsigned char *buffer1, unsigned char *buffer2, const unsigned int samples)
+{
+  Q_ASSERT(m_codec_context);
+
+  const uint8_t *input[2] = { buffer1, buffer2 };
+  const auto capacity = swr_get_out_samples(m_resampler, samples);
+
+  // the conversion buffer only grows, most of the calls have the same number of samples.
+  if(m_converted->nb_samples < capacity)
+  {
+    av_frame_unref(m_converted);
+    m_converted->format     = m_codec_context->sample_fmt;
+    m_converted->nb_samples = capacity;
+    av_channel_layout_copy(&m_converted->ch_layout, &m_codec_context->ch_layout);
+
+    const auto code = av_frame_get_buffer(m_converted, 0);
+    if(code < 0) return set_error(QString("Couldn't allocate the conversion buffer"), code);
+  }
+
+  const auto converted = swr_convert(m_resampler, m_converted->data, m_converted->nb_samples, input, samples);
+  if(converted < 0) return set_error(QString("Error converting the samples"), converted);
+
+  if(av_audio_fifo_write(m_fifo, reinterpret_cast<void **>(m_converted->data), converted) < converted)
+  {
+    m_error = QString("Couldn't store the converted samples");
+    return false;
+  }
+
+  while(av_audio_fifo_size(m_fifo) >= m_frame_size)
+  {
+    if(!encode_frame(m_frame_size)) return false;
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool LibavEncoder::finish()
+{
+  Q_ASSERT(m_codec_context);
+
+  // samples delayed by the resampler.
+  auto converted = swr_convert(m_resampler, m_converted->data, m_converted->nb_samples, nullptr, 0);
+  while(converted > 0)
+  {
+    av_audio_fifo_write(m_fifo, reinterpret_cast<void **>(m_converted->data), converted);
+    converted = swr_convert(m_resampler, m_converted->data, m_converted->nb_samples, nullptr, 0);
+  }
+
+  while(av_audio_fifo_size(m_fifo) > 0)
+  {
+    const auto remaining = av_audio_fifo_size(m_fifo);
+    if(!encode_frame(m_small_last_frame ? std::min(remaining, m_frame_size) : m_frame_size)) return false;
+  }
+
+  if(!send_frame(nullptr)) return false;
+
+  const auto code = av_write_trailer(m_format_context);
+  if(code < 0) return set_error(QString("Couldn't write the trailer"), code);
+
+  avio_flush(m_io_context);
+  release();
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+int LibavEncoder::write_packet(void *opaque, const uint8_t *buffer, int size)
+{
+  auto encoder = reinterpret_cast<LibavEncoder *>(opaque);
+
+  if(encoder->m_device->write(reinterpret_cast<const char *>(buffer), size) != size) return AVERROR(EIO);
+
+  return size;
+}
+
+//-----------------------------------------------------------------
+int64_t LibavEncoder::seek(void *opaque, int64_t offset, int whence)
+{
+  auto device = reinterpret_cast<LibavEncoder *>(opaque)->m_device;
+
+  switch(whence & ~AVSEEK_FORCE)
+  {
+    case AVSEEK_SIZE:
+      return device->size();
+    case SEEK_CUR:
+      offset += device->pos();
+      break;
+    case SEEK_END:
+      offset += device->size();
+      break;
+    case SEEK_SET:
+    default:
+      break;
+  }
+
+  return device->seek(offset) ? offset : AVERROR(EIO);
+}
+
+//-----------------------------------------------------------------
+AVSampleFormat LibavEncoder::sample_format(const Sample_format format)
+{
+  switch(format)
+  {
+    case Sample_format::SIGNED_16:         return AV_SAMPLE_FMT_S16;
+    case Sample_format::FLOAT:             return AV_SAMPLE_FMT_FLT;
+    case Sample_format::DOUBLE:            return AV_SAMPLE_FMT_DBL;
+    case Sample_format::SIGNED_16_PLANAR:  return AV_SAMPLE_FMT_S16P;
+    case Sample_format::SIGNED_32_PLANAR:  return AV_SAMPLE_FMT_S32P;
+    case Sample_format::FLOAT_PLANAR:      return AV_SAMPLE_FMT_FLTP;
+    case Sample_format::DOUBLE_PLANAR:     return AV_SAMPLE_FMT_DBLP;
+    case Sample_format::UNSIGNED_8:        return AV_SAMPLE_FMT_U8;
+    case Sample_format::UNSIGNED_8_PLANAR: return AV_SAMPLE_FMT_U8P;
+    case Sample_format::SIGNED_32:         return AV_SAMPLE_FMT_S32;
+    default:
+      break;
+  }
+
+  return AV_SAMPLE_FMT_NONE;
+}
+
+//-----------------------------------------------------------------
+bool LibavEncoder::encode_frame(const int samples)
+{
+  av_frame_unref(m_frame);
+  m_frame->format      = m_codec_context->sample_fmt;
+  m_frame->sample_rate = m_codec_context->sample_rate;
+  m_frame->nb_samples  = samples;
+  av_channel_layout_copy(&m_frame->ch_layout, &m_codec_context->ch_layout);
+
+  const auto code = av_frame_get_buffer(m_frame, 0);
+  if(code < 0) return set_error(QString("Couldn't allocate the frame"), code);
+
+  const auto read = av_audio_fifo_read(m_fifo, reinterpret_cast<void **>(m_frame->data), samples);
+  if(read < samples)
+  {
+    av_samples_set_silence(m_frame->data, std::max(0, read), samples - std::max(0, read), m_frame->ch_layout.nb_channels, m_codec_context->sample_fmt);
+  }
+
+  m_frame->pts = m_pts;
+  m_pts += samples;
+
+  return send_frame(m_frame);
+}
+
+//-----------------------------------------------------------------
+bool LibavEncoder::send_frame(AVFrame *frame)
+{
+  auto code = avcodec_send_frame(m_codec_context, frame);
+  if(code < 0) return set_error(QString("Error sending the samples to the encoder"), code);
+
+  while(true)
+  {
+    code = avcodec_receive_packet(m_codec_context, m_packet);
+    if(code == AVERROR(EAGAIN) || code == AVERROR_EOF) break;
+    if(code < 0) return set_error(QString("Error encoding the samples"), code);
+
+    m_packet->stream_index = m_stream->index;
+    av_packet_rescale_ts(m_packet, m_codec_context->time_base, m_stream->time_base);
+
+    code = av_interleaved_write_frame(m_format_context, m_packet);
+    if(code < 0) return set_error(QString("Error writing the encoded data"), code);
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool LibavEncoder::set_error(const QString &message, const int code)
+{
+  char buffer[AV_ERROR_MAX_STRING_SIZE];
+  av_strerror(code, buffer, sizeof(buffer));
+
+  m_error = QString("%1. Error is \"%2\"").arg(message).arg(QString::fromUtf8(buffer));
+
+  return false;
+}
+
+//-----------------------------------------------------------------
+void LibavEncoder::release()
+{
+  av_packet_free(&m_packet);
+  av_frame_free(&m_frame);
+  av_frame_free(&m_converted);
+
+  if(m_fifo)
+  {
+    av_audio_fifo_free(m_fifo);
+    m_fifo = nullptr;
+  }
+
+  swr_free(&m_resampler);
+  avcodec_free_context(&m_codec_context);
+
+  if(m_format_context)
+  {
+    avformat_free_context(m_format_context);
+    m_format_context = nullptr;
+    m_stream         = nullptr;
+  }
+
+  if(m_io_context)
+  {
+    av_freep(&m_io_context->buffer);
+    avio_context_free(&m_io_context);
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ File: LibavEncoder.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBAV_ENCODER_H_
+#define LIBAV_ENCODER_H_
+
+// Project
+#include "Encoder.h"
+
+// libav
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/audio_fifo.h>
+#include <libswresample/swresample.h>
+}
+
+/** \class LibavEncoder
+ * \brief Encodes AAC, Opus and Vorbis streams with the libav encoders and muxers. The samples are
+ *        converted to the format and sample rate of the encoder with libswresample.
+ *
+ */
+class LibavEncoder
+: public Encoder
+{
+  public:
+    /** \brief LibavEncoder class constructor.
+     * \param[in] codec output codec.
+     *
+     */
+    explicit LibavEncoder(const Utils::Codec codec);
+
+    /** \brief LibavEncoder class virtual destructor.
+     *
+     */
+    virtual ~LibavEncoder();
+
+    virtual bool init(const Utils::OutputProfile &profile, const Input &input, const QMap<QString, QString> &tags, QIODevice *device) override;
+
+    virtual bool encode(unsigned char *buffer1, unsigned char *buffer2, const unsigned int samples) override;
+
+    virtual bool finish() override;
+
+    virtual QString extension() const override
+    { return m_extension; }
+
+    virtual Sample_format preferred_format() const override
+    { return Sample_format::FLOAT_PLANAR; }
+
+    virtual bool usesID3Tags() const override
+    { return false; }
+
+    /** \brief Returns the libav sample format of the given sample format.
+     * \param[in] format sample format.
+     *
+     */
+    static AVSampleFormat sample_format(const Sample_format format);
+
+  private:
+    static const int IO_BUFFER_SIZE = 65536; /** size of the buffer of the output context. */
+
+    /** \brief Writes the data of the muxer to the output device.
+     * \param[in] opaque pointer to the encoder.
+     * \param[in] buffer data buffer.
+     * \param[in] size size of the data in bytes.
+     *
+     */
+    static int write_packet(void *opaque, const uint8_t *buffer, int size);
+
+    /** \brief Seeks the output device for the muxer.
+     * \param[in] opaque pointer to the encoder.
+     * \param[in] offset seek offset.
+     * \param[in] whence seek origin or AVSEEK_SIZE.
+     *
+     */
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+
+    /** \brief Encodes a frame with the given number of samples of the fifo. The frame is padded
+     *         with silence if the fifo has less samples.
+     * \param[in] samples number of samples per channel of the frame.
+     *
+     */
+    bool encode_frame(const int samples);
+
+    /** \brief Sends the frame to the encoder and writes the resulting packets. A null frame flushes
+     *         the encoder.
+     * \param[in] frame frame to encode or nullptr.
+     *
+     */
+    bool send_frame(AVFrame *frame);
+
+    /** \brief Sets the error message with the description of the given libav error code and
+     *         returns false.
+     * \param[in] message error message.
+     * \param[in] code libav error code.
+     *
+     */
+    bool set_error(const QString &message, const int code);
+
+    /** \brief Frees the libav structures.
+     *
+     */
+    void release();
+
+    const Utils::Codec m_codec;            /** output codec.                                        */
+    QString            m_extension;        /** extension of the output files.                       */
+    QIODevice         *m_device;           /** output device.                                       */
+    AVFormatContext   *m_format_context;   /** muxer context.                                       */
+    AVIOContext       *m_io_context;       /** output context writing to the device.                */
+    AVCodecContext    *m_codec_context;    /** encoder context.                                     */
+    AVStream          *m_stream;           /** output stream.                                       */
+    SwrContext        *m_resampler;        /** converter of the input samples.                      */
+    AVAudioFifo       *m_fifo;             /** converted samples waiting to fill a frame.           */
+    AVFrame           *m_converted;        /** buffer of the converted samples.                     */
+    AVFrame           *m_frame;            /** frame sent to the encoder.                           */
+    AVPacket          *m_packet;           /** packet received from the encoder.                    */
+    int                m_frame_size;       /** number of samples per channel of the frames.         */
+    bool               m_small_last_frame; /** true if the last frame can be smaller.               */
+    long long          m_pts;              /** presentation time of the next frame, in samples.     */
+};
+
+#endif // LIBAV_ENCODER_H_
@@ -0,0 +1,373 @@
+/*
+ File: LibraryIndex.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "LibraryIndex.h"
+#include "FileClassifier.h"
+
+// Qt
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QWriteLocker>
+#include <QtEndian>
+
+// C++
+#include <cstring>
+#include <utility>
+
+const quint32 LibraryIndex::MAGIC   = 0x4D334C49u; // "M3LI"
+const quint32 LibraryIndex::VERSION = 1;
+
+QReadWriteLock         LibraryIndex::s_lock;
+QMutex                 LibraryIndex::s_write;
+QFile                  LibraryIndex::s_file;
+uchar                 *LibraryIndex::s_data = nullptr;
+qint64                 LibraryIndex::s_size = 0;
+QHash<quint64, qint64> LibraryIndex::s_offsets;
+QByteArray             LibraryIndex::s_settings;
+
+namespace
+{
+  // the file starts with the magic and the version. every record is framed with the length of the
+  // payload and the key of the path before it and the checksum of the payload after it, so the
+  // offsets table is built without reading the payloads and an interrupted append is detected.
+  const qint64 HEADER_SIZE  = 8;
+  const qint64 FRAME_HEADER = 12;
+  const qint64 FRAME_SIZE   = 16;
+
+  //-----------------------------------------------------------------
+  quint32 checksum(const char *data, const qint64 size)
+  {
+    // FNV-1a
+    quint32 hash = 2166136261u;
+    for(qint64 i = 0; i < size; ++i)
+    {
+      hash ^= static_cast<uchar>(data[i]);
+      hash *= 16777619u;
+    }
+
+    return hash;
+  }
+
+  //-----------------------------------------------------------------
+  QByteArray file_header(const quint32 magic, const quint32 version)
+  {
+    QByteArray header(HEADER_SIZE, Qt::Uninitialized);
+    qToLittleEndian<quint32>(magic, header.data());
+    qToLittleEndian<quint32>(version, header.data() + 4);
+
+    return header;
+  }
+}
+
+//-----------------------------------------------------------------
+void LibraryIndex::open(const Utils::TranscoderConfiguration &configuration)
+{
+  QWriteLocker lock(&s_lock);
+
+  release();
+
+  s_settings = settings_hash(configuration);
+
+  QDir().mkpath(QFileInfo(file_name()).absolutePath());
+
+  s_file.setFileName(file_name());
+  if(!s_file.open(QIODevice::ReadWrite)) return;
+
+  const auto header = file_header(MAGIC, VERSION);
+  if(s_file.read(HEADER_SIZE) != header)
+  {
+    // new file or from another version, started again.
+    s_file.resize(0);
+    s_file.seek(0);
+    s_file.write(header);
+    s_file.flush();
+  }
+
+  qint64 records = 0;
+  const auto valid = map(records);
+  if(valid < s_file.size())
+  {
+    // the end of an interrupted append.
+    s_file.unmap(s_data);
+    s_data = nullptr;
+    s_file.resize(valid);
+    map(records);
+  }
+
+  if(records > 2 * s_offsets.size() + COMPACT_MARGIN)
+  {
+    compact();
+  }
+
+  s_file.seek(s_file.size());
+}
+
+//-----------------------------------------------------------------
+void LibraryIndex::close()
+{
+  QWriteLocker lock(&s_lock);
+
+  release();
+}
+
+//-----------------------------------------------------------------
+bool LibraryIndex::up_to_date(const QFileInfo &file, const QString &directory, const QSet<QString> &outputs)
+{
+  QReadLocker lock(&s_lock);
+
+  if(!s_data) return false;
+
+  const auto path = file.absoluteFilePath();
+
+  // the keys can collide, the path of the record is checked. a source that collides with another is
+  // only transcoded again.
+  const auto it = s_offsets.constFind(key(path));
+  if(it == s_offsets.constEnd()) return false;
+
+  Record record;
+  if(!read(it.value(), record) || record.path != path || record.settings != s_settings || record.size != file.size()) return false;
+
+  for(const auto &output: record.outputs)
+  {
+    // the outputs in the directory of the source are in the listing of the scan, the rest are checked.
+    const bool exists = output.contains('/') ? QFileInfo::exists(directory + output) : outputs.contains(output.toLower());
+    if(!exists) return false;
+  }
+
+  const auto modified = file.lastModified().toMSecsSinceEpoch();
+  if(record.modified == modified) return true;
+
+  // touched but with the same contents, the new time is stored so the contents aren't read again.
+  if(record.contents.isEmpty() || record.contents != contents_hash(path)) return false;
+
+  record.modified = modified;
+  write(record);
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+void LibraryIndex::add(const QString &file_name, const QStringList &outputs)
+{
+  QReadLocker lock(&s_lock);
+
+  if(!s_file.isOpen()) return;
+
+  const QFileInfo info(file_name);
+
+  Record record;
+  record.path     = info.absoluteFilePath();
+  record.size     = info.size();
+  record.modified = info.lastModified().toMSecsSinceEpoch();
+  record.kind     = static_cast<qint8>(FileClassifier::classify(info));
+  record.contents = contents_hash(record.path);
+  record.settings = s_settings;
+  record.outputs  = outputs;
+
+  write(record);
+}
+
+//-----------------------------------------------------------------
+QByteArray LibraryIndex::settings_hash(const Utils::TranscoderConfiguration &configuration)
+{
+  const auto &format = configuration.formatConfiguration();
+
+  QByteArray settings;
+  QDataStream stream(&settings, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_6_0);
+
+  stream << configuration.bitrate() << configuration.quality() << static_cast<int>(configuration.encodingMode())
+         << configuration.vbrQuality() << configuration.adaptBitrateToSource() << configuration.minimumBitrate()
+         << Utils::outputProfilesToString(configuration.additionalProfiles()) << configuration.useCueToSplit()
+         << static_cast<int>(configuration.cuePregapPolicy()) << configuration.useMetadataToRenameOutput()
+         << configuration.writeOutputTags() << configuration.extractMetadataCoverPicture() << configuration.coverPictureName()
+         << configuration.stripTagsFromMp3();
+
+  stream << format.apply << format.chars_to_delete << format.chars_to_replace << format.number_of_digits
+         << format.number_and_name_separator << format.to_title_case << format.prefix_disk_num << format.character_simplification;
+
+  return QCryptographicHash::hash(settings, QCryptographicHash::Sha1);
+}
+
+//-----------------------------------------------------------------
+QByteArray LibraryIndex::contents_hash(const QString &file_name)
+{
+  QFile file(file_name);
+  if(!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+  const auto size = file.size();
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QByteArray::number(size));
+  hash.addData(file.read(HASH_BLOCK));
+
+  const qint64 tail = size - HASH_BLOCK;
+  if(tail > 0 && file.seek(tail))
+  {
+    hash.addData(file.read(HASH_BLOCK));
+  }
+
+  return hash.result();
+}
+
+//-----------------------------------------------------------------
+quint64 LibraryIndex::key(const QString &path)
+{
+  // FNV-1a of the UTF-16 code units, the same in every run.
+  quint64 hash = 14695981039346656037ull;
+  for(const auto c: path)
+  {
+    hash ^= c.unicode();
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+//-----------------------------------------------------------------
+qint64 LibraryIndex::map(qint64 &records)
+{
+  s_offsets.clear();
+  records = 0;
+
+  s_size = s_file.size();
+  if(s_size <= HEADER_SIZE) return s_size;
+
+  s_data = s_file.map(0, s_size);
+  if(!s_data)
+  {
+    // nothing is skipped but the records are kept.
+    s_size = 0;
+    return s_file.size();
+  }
+
+  s_offsets.reserve(s_size / 256);
+
+  qint64 offset = HEADER_SIZE;
+  while(offset + FRAME_SIZE <= s_size)
+  {
+    const qint64 length = qFromLittleEndian<quint32>(s_data + offset);
+    if(offset + FRAME_SIZE + length > s_size) break;
+
+    const auto payload = reinterpret_cast<const char *>(s_data + offset + FRAME_HEADER);
+    if(qFromLittleEndian<quint32>(s_data + offset + FRAME_HEADER + length) != checksum(payload, length)) break;
+
+    // the last record of a source replaces the previous ones.
+    s_offsets.insert(qFromLittleEndian<quint64>(s_data + offset + 4), offset);
+    ++records;
+
+    offset += FRAME_SIZE + length;
+  }
+
+  return offset;
+}
+
+//-----------------------------------------------------------------
+bool LibraryIndex::read(const qint64 offset, Record &record)
+{
+  if(!s_data || offset + FRAME_SIZE > s_size) return false;
+
+  const qint64 length = qFromLittleEndian<quint32>(s_data + offset);
+  const auto payload  = QByteArray::fromRawData(reinterpret_cast<const char *>(s_data + offset + FRAME_HEADER), length);
+
+  QDataStream stream(payload);
+  stream.setVersion(QDataStream::Qt_6_0);
+  stream >> record.path >> record.size >> record.modified >> record.kind >> record.contents >> record.settings >> record.outputs;
+
+  return stream.status() == QDataStream::Ok;
+}
+
+//-----------------------------------------------------------------
+void LibraryIndex::write(const Record &record)
+{
+  QByteArray payload;
+  QDataStream stream(&payload, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_6_0);
+  stream << record.path << record.size << record.modified << record.kind << record.contents << record.settings << record.outputs;
+
+  QByteArray frame(FRAME_SIZE + payload.size(), Qt::Uninitialized);
+  qToLittleEndian<quint32>(payload.size(), frame.data());
+  qToLittleEndian<quint64>(key(record.path), frame.data() + 4);
+  std::memcpy(frame.data() + FRAME_HEADER, payload.constData(), payload.size());
+  qToLittleEndian<quint32>(checksum(payload.constData(), payload.size()), frame.data() + FRAME_HEADER + payload.size());
+
+  // a single write, the records aren't mixed. the new records aren't added to the offsets table, every
+  // source is looked up once per run.
+  QMutexLocker lock(&s_write);
+  s_file.write(frame);
+}
+
+//-----------------------------------------------------------------
+void LibraryIndex::release()
+{
+  if(s_data)
+  {
+    s_file.unmap(s_data);
+    s_data = nullptr;
+  }
+
+  s_size = 0;
+  s_offsets.clear();
+  s_offsets.squeeze();
+
+  if(s_file.isOpen())
+  {
+    s_file.close();
+  }
+}
+
+//-----------------------------------------------------------------
+void LibraryIndex::compact()
+{
+  // written to a temporary file and renamed, an interrupted compaction doesn't lose the index.
+  QSaveFile file(file_name());
+  if(!file.open(QIODevice::WriteOnly)) return;
+
+  file.write(file_header(MAGIC, VERSION));
+
+  for(const auto offset: std::as_const(s_offsets))
+  {
+    const qint64 length = qFromLittleEndian<quint32>(s_data + offset);
+    file.write(reinterpret_cast<const char *>(s_data + offset), FRAME_SIZE + length);
+  }
+
+  // the index can't be replaced while it's open.
+  release();
+
+  file.commit();
+
+  s_file.setFileName(file_name());
+  if(!s_file.open(QIODevice::ReadWrite)) return;
+
+  qint64 records = 0;
+  map(records);
+}
+
+//-----------------------------------------------------------------
+QString LibraryIndex::file_name()
+{
+  return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QString("/library.log");
+}
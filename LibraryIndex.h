@@ -0,0 +1,160 @@
+/*
+ File: LibraryIndex.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBRARY_INDEX_H_
+#define LIBRARY_INDEX_H_
+
+// Project
+#include "Utils.h"
+
+// Qt
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/** \class LibraryIndex
+ * \brief Keeps between runs the sources transcoded successfully, with their size, time, contents hash,
+ *        outputs and the hash of the settings used, so the sources that haven't changed are skipped
+ *        without opening them. Stored in the application local data directory as an append-only log
+ *        that is memory mapped when opened, only the offsets of the records are kept in memory.
+ *
+ */
+class LibraryIndex
+{
+  public:
+    /** \brief Opens the index for a run with the given configuration. The records written with other
+     *         settings aren't valid.
+     * \param[in] configuration configuration of the run.
+     *
+     */
+    static void open(const Utils::TranscoderConfiguration &configuration);
+
+    /** \brief Writes the pending records and closes the index.
+     *
+     */
+    static void close();
+
+    /** \brief Returns true if the source has been transcoded with the current settings, hasn't changed
+     *         since then and all its outputs exist.
+     * \param[in] file source file information, from the directory entry.
+     * \param[in] directory directory of the source, with the separator at the end.
+     * \param[in] outputs names of the MP3 files of the directory, in lower case.
+     *
+     */
+    static bool up_to_date(const QFileInfo &file, const QString &directory, const QSet<QString> &outputs);
+
+    /** \brief Adds a source transcoded successfully to the index.
+     * \param[in] file_name absolute file name of the source.
+     * \param[in] outputs file names of the outputs, relative to the directory of the source.
+     *
+     */
+    static void add(const QString &file_name, const QStringList &outputs);
+
+    /** \brief Returns the hash of the settings that affect the outputs.
+     * \param[in] configuration configuration of the run.
+     *
+     */
+    static QByteArray settings_hash(const Utils::TranscoderConfiguration &configuration);
+
+  private:
+    /** \struct Record
+     * \brief Source of the index.
+     *
+     */
+    struct Record
+    {
+      QString     path;     /** absolute file name.                                     */
+      qint64      size;     /** size in bytes.                                          */
+      qint64      modified; /** modification time in milliseconds since the epoch.      */
+      qint8       kind;     /** kind of the file by its contents, see FileClassifier.   */
+      QByteArray  contents; /** hash of the size and the beginning and end of the file. */
+      QByteArray  settings; /** hash of the settings that affect the outputs.           */
+      QStringList outputs;  /** outputs, relative to the directory of the source.       */
+    };
+
+    /** \brief Returns the hash of the size and the first and last blocks of the file, or an empty
+     *         array if it can't be read.
+     * \param[in] file_name absolute file name.
+     *
+     */
+    static QByteArray contents_hash(const QString &file_name);
+
+    /** \brief Returns the key of the path in the offsets table.
+     * \param[in] path absolute file name.
+     *
+     */
+    static quint64 key(const QString &path);
+
+    /** \brief Maps the file and fills the offsets table with the last record of every source. Returns
+     *         the size of the valid records at the beginning of the file, the rest can be discarded.
+     *         The lock must be held for writing.
+     * \param[out] records number of valid records in the file.
+     *
+     */
+    static qint64 map(qint64 &records);
+
+    /** \brief Reads the record at the given offset of the mapped file. Returns false if it's invalid.
+     * \param[in] offset offset of the record.
+     * \param[out] record record information.
+     *
+     */
+    static bool read(const qint64 offset, Record &record);
+
+    /** \brief Appends the record to the file.
+     * \param[in] record record information.
+     *
+     */
+    static void write(const Record &record);
+
+    /** \brief Unmaps and closes the file. The lock must be held for writing.
+     *
+     */
+    static void release();
+
+    /** \brief Rewrites the file with only the last record of every source. The lock must be held for writing.
+     *
+     */
+    static void compact();
+
+    /** \brief Returns the absolute file name of the index.
+     *
+     */
+    static QString file_name();
+
+    static const quint32 MAGIC;                  /** index file identifier.                                          */
+    static const quint32 VERSION;                /** index file version.                                             */
+    static const qint64  HASH_BLOCK     = 65536; /** bytes of the beginning and end of the file in the contents hash. */
+    static const qint64  COMPACT_MARGIN = 1000;  /** obsolete records allowed over the valid ones before compacting. */
+
+    static QReadWriteLock         s_lock;     /** protects the mapped file and the offsets table. */
+    static QMutex                 s_write;    /** protects the appends to the file.               */
+    static QFile                  s_file;     /** index file.                                     */
+    static uchar                 *s_data;     /** mapped contents of the file.                    */
+    static qint64                 s_size;     /** size of the mapped contents.                    */
+    static QHash<quint64, qint64> s_offsets;  /** offset of the last record of every source.      */
+    static QByteArray             s_settings; /** hash of the settings of the run.                */
+};
+
+#endif // LIBRARY_INDEX_H_
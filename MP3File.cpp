@@ -0,0 +1,621 @@
+/*
+ File: MP3File.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "MP3File.h"
+
+// Qt
+#include <QFile>
+#include <QStringDecoder>
+#include <QtEndian>
+
+// C++
+#include <algorithm>
+
+const int ID3V2_HEADER_SIZE = 10;
+const int ID3V1_SIZE        = 128;
+const int APE_FOOTER_SIZE   = 32;
+const int FRAME_SEARCH_SIZE = 16384;
+const int FRONT_COVER_TYPE  = 3;
+
+// value of the TSSE frame of the tags written by this program.
+const QString SOFTWARE_NAME = "Music Transcoder To MP3";
+
+const int BITRATES_MPEG1[16]  = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };
+const int BITRATES_MPEG2[16]  = { 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160, 0 };
+const int SAMPLERATES[4][3]   = { { 11025, 12000,  8000 },   // MPEG 2.5
+                                  {     0,     0,     0 },   // reserved
+                                  { 22050, 24000, 16000 },   // MPEG 2
+                                  { 44100, 48000, 32000 } }; // MPEG 1
+
+//-----------------------------------------------------------------
+unsigned int syncsafeInteger(const unsigned char *data)
+{
+  return ((data[0] & 0x7F) << 21) | ((data[1] & 0x7F) << 14) | ((data[2] & 0x7F) << 7) | (data[3] & 0x7F);
+}
+
+//-----------------------------------------------------------------
+QByteArray removeUnsynchronisation(const QByteArray &data)
+{
+  QByteArray result;
+  result.reserve(data.size());
+
+  for(int i = 0; i < data.size(); ++i)
+  {
+    result.append(data.at(i));
+
+    // 0xFF 0x00 sequences are 0xFF in the original data.
+    if(static_cast<unsigned char>(data.at(i)) == 0xFF && i + 1 < data.size() && data.at(i + 1) == '\0') ++i;
+  }
+
+  return result;
+}
+
+//-----------------------------------------------------------------
+QString decodeID3Text(const QByteArray &data, const int encoding)
+{
+  QString text;
+
+  switch(encoding)
+  {
+    case 0:
+      text = QString::fromLatin1(data);
+      break;
+    case 1:
+      {
+        QStringDecoder decoder(QStringConverter::Utf16); // uses the BOM
+        text = decoder.decode(data);
+      }
+      break;
+    case 2:
+      {
+        QStringDecoder decoder(QStringConverter::Utf16BE);
+        text = decoder.decode(data);
+      }
+      break;
+    case 3:
+      text = QString::fromUtf8(data);
+      break;
+    default:
+      break;
+  }
+
+  // ID3v2.4 can have several values separated by null characters, only the first one is used.
+  const auto end = text.indexOf(QChar('\0'));
+  if(end != -1) text.truncate(end);
+
+  return text.trimmed();
+}
+
+//-----------------------------------------------------------------
+int positionNumber(const QString &text)
+{
+  // values can be in "number/total" form.
+  return text.section('/', 0, 0).trimmed().toInt();
+}
+
+//-----------------------------------------------------------------
+QString pictureMimeType(const QByteArray &data)
+{
+  if(data.startsWith("\xFF\xD8"))                            return QString("image/jpeg");
+  if(data.startsWith("\x89PNG"))                             return QString("image/png");
+  if(data.startsWith("BM"))                                  return QString("image/bmp");
+  if(data.startsWith("II*") || data.startsWith("MM\x00*"))   return QString("image/tiff");
+
+  return QString();
+}
+
+//-----------------------------------------------------------------
+void parseID3Picture(const QByteArray &data, const int version, MP3File::Information &information, bool &has_front_cover)
+{
+  if(data.size() < 2 || has_front_cover) return;
+
+  const auto encoding = static_cast<unsigned char>(data.at(0));
+  int position = 1;
+  QString mime;
+
+  if(version == 2)
+  {
+    if(data.size() < 5) return;
+
+    const auto format = QString::fromLatin1(data.mid(1, 3)).toLower();
+    mime = QString("image/") + (format == "jpg" ? QString("jpeg") : format);
+    position = 4;
+  }
+  else
+  {
+    const auto end = data.indexOf('\0', position);
+    if(end == -1) return;
+
+    mime = QString::fromLatin1(data.mid(position, end - position)).toLower();
+    position = end + 1;
+  }
+
+  if(position >= data.size()) return;
+
+  const auto type = static_cast<unsigned char>(data.at(position++));
+
+  // skip the description, UTF-16 strings end with two null bytes.
+  if(encoding == 1 || encoding == 2)
+  {
+    while(position + 1 < data.size() && (data.at(position) != '\0' || data.at(position + 1) != '\0')) position += 2;
+    position += 2;
+  }
+  else
+  {
+    while(position < data.size() && data.at(position) != '\0') ++position;
+    position += 1;
+  }
+
+  if(position >= data.size()) return;
+
+  // the front cover is preferred over any other picture.
+  if(information.cover.isEmpty() || type == FRONT_COVER_TYPE)
+  {
+    information.cover      = data.mid(position);
+    information.cover_mime = mime;
+    has_front_cover        = (type == FRONT_COVER_TYPE);
+  }
+}
+
+//-----------------------------------------------------------------
+void parseID3v2Frames(const QByteArray &body, const int version, const bool unsynchronised, MP3File::Information &information)
+{
+  const int id_size     = (version == 2) ? 3 : 4;
+  const int header_size = (version == 2) ? 6 : 10;
+
+  bool has_front_cover = false;
+  long long position = 0;
+
+  while(position + header_size <= body.size())
+  {
+    const auto header = reinterpret_cast<const unsigned char *>(body.constData() + position);
+    if(header[0] == 0) break; // padding
+
+    const auto id = body.mid(position, id_size);
+
+    long long size = 0;
+    int flags = 0;
+    switch(version)
+    {
+      case 2:
+        size = (header[3] << 16) | (header[4] << 8) | header[5];
+        break;
+      case 3:
+        size  = qFromBigEndian<quint32>(header + 4);
+        flags = (header[8] << 8) | header[9];
+        break;
+      default:
+        size  = syncsafeInteger(header + 4);
+        flags = (header[8] << 8) | header[9];
+        break;
+    }
+
+    position += header_size;
+    if(size <= 0 || position + size > body.size()) break;
+
+    auto data = body.mid(position, size);
+    position += size;
+
+    // compressed and encrypted frames are ignored.
+    if(version == 3)
+    {
+      if(flags & 0x00C0) continue;
+      if(flags & 0x0020) data.remove(0, 1); // group identifier
+    }
+    else if(version == 4)
+    {
+      if(flags & 0x000C) continue;
+      if(flags & 0x0040) data.remove(0, 1); // group identifier
+      if(flags & 0x0001) data.remove(0, 4); // data length indicator
+      if((flags & 0x0002) || unsynchronised) data = removeUnsynchronisation(data);
+    }
+
+    if(data.isEmpty()) continue;
+
+    const auto encoding = static_cast<unsigned char>(data.at(0));
+
+    if(id == "TIT2" || id == "TT2")
+    {
+      information.title = decodeID3Text(data.mid(1), encoding);
+    }
+    else if(id == "TPE1" || id == "TP1")
+    {
+      information.artist = decodeID3Text(data.mid(1), encoding);
+    }
+    else if(id == "TALB" || id == "TAL")
+    {
+      information.album = decodeID3Text(data.mid(1), encoding);
+    }
+    else if(id == "TRCK" || id == "TRK")
+    {
+      information.track = positionNumber(decodeID3Text(data.mid(1), encoding));
+    }
+    else if(id == "TPOS" || id == "TPA")
+    {
+      information.disc = positionNumber(decodeID3Text(data.mid(1), encoding));
+    }
+    else if(id == "TSSE" || id == "TSS")
+    {
+      information.own_tag = (decodeID3Text(data.mid(1), encoding) == SOFTWARE_NAME);
+    }
+    else if(id == "APIC" || id == "PIC")
+    {
+      parseID3Picture(data, version, information, has_front_cover);
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+bool parseID3v2(QFile &file, MP3File::Information &information, const bool read_tags)
+{
+  const auto header = file.read(ID3V2_HEADER_SIZE);
+  if(header.size() != ID3V2_HEADER_SIZE || !header.startsWith("ID3")) return true;
+
+  const auto bytes   = reinterpret_cast<const unsigned char *>(header.constData());
+  const int  version = bytes[3];
+  const int  flags   = bytes[5];
+  const auto size    = syncsafeInteger(bytes + 6);
+
+  if(version < 2 || version > 4) return false;
+
+  // ID3v2.2 compression was never defined.
+  if(version == 2 && (flags & 0x40)) return false;
+
+  information.id3v2_size = ID3V2_HEADER_SIZE + size + ((version == 4 && (flags & 0x10)) ? ID3V2_HEADER_SIZE : 0);
+  if(information.id3v2_size > information.file_size) return false;
+
+  if(!read_tags) return true;
+
+  auto body = file.read(size);
+  if(body.size() != static_cast<int>(size)) return false;
+
+  const bool unsynchronised = (flags & 0x80);
+  if(unsynchronised && version < 4)
+  {
+    body = removeUnsynchronisation(body);
+  }
+
+  long long position = 0;
+  if(version > 2 && (flags & 0x40) && body.size() >= 4)
+  {
+    // extended header, size doesn't include itself in ID3v2.3.
+    const auto ext_bytes = reinterpret_cast<const unsigned char *>(body.constData());
+    position = (version == 3) ? 4 + qFromBigEndian<quint32>(ext_bytes) : syncsafeInteger(ext_bytes);
+    if(position > body.size()) return false;
+  }
+
+  parseID3v2Frames(body.mid(position), version, unsynchronised && version == 4, information);
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+void parseAPEItems(const QByteArray &items, const unsigned int count, MP3File::Information &information)
+{
+  long long position = 0;
+
+  for(unsigned int i = 0; i < count && position + 8 < items.size(); ++i)
+  {
+    const long long size  = qFromLittleEndian<quint32>(items.constData() + position);
+    const auto      flags = qFromLittleEndian<quint32>(items.constData() + position + 4);
+    position += 8;
+
+    const auto key_end = items.indexOf('\0', position);
+    if(key_end == -1) break;
+
+    const auto key = QString::fromLatin1(items.mid(position, key_end - position)).toLower();
+    position = key_end + 1;
+
+    if(position + size > items.size()) break;
+
+    const auto value = items.mid(position, size);
+    position += size;
+
+    const bool is_text = ((flags >> 1) & 0x03) == 0;
+    if(is_text)
+    {
+      const auto text = QString::fromUtf8(value).section(QChar('\0'), 0, 0).trimmed();
+
+      if(key == "title"  && information.title.isEmpty())  information.title  = text;
+      if(key == "artist" && information.artist.isEmpty()) information.artist = text;
+      if(key == "album"  && information.album.isEmpty())  information.album  = text;
+      if(key == "track"  && information.track == 0)       information.track  = positionNumber(text);
+      if(key == "disc"   && information.disc == 0)        information.disc   = positionNumber(text);
+    }
+    else if(key == "cover art (front)" && information.cover.isEmpty())
+    {
+      // binary value is the file name followed by the picture data.
+      const auto name_end = value.indexOf('\0');
+      if(name_end != -1)
+      {
+        information.cover      = value.mid(name_end + 1);
+        information.cover_mime = pictureMimeType(information.cover);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+bool parseTrailingTags(QFile &file, MP3File::Information &information, const bool read_tags)
+{
+  QByteArray id3v1;
+
+  if(information.file_size - information.id3v2_size >= ID3V1_SIZE)
+  {
+    if(!file.seek(information.file_size - ID3V1_SIZE)) return false;
+
+    id3v1 = file.read(ID3V1_SIZE);
+    if(id3v1.size() == ID3V1_SIZE && id3v1.startsWith("TAG"))
+    {
+      information.trailing_size = ID3V1_SIZE;
+    }
+    else
+    {
+      id3v1.clear();
+    }
+  }
+
+  const auto ape_end = information.file_size - information.trailing_size;
+  if(ape_end - information.id3v2_size >= APE_FOOTER_SIZE)
+  {
+    if(!file.seek(ape_end - APE_FOOTER_SIZE)) return false;
+
+    const auto footer = file.read(APE_FOOTER_SIZE);
+    if(footer.size() == APE_FOOTER_SIZE && footer.startsWith("APETAGEX"))
+    {
+      const long long size  = qFromLittleEndian<quint32>(footer.constData() + 12);
+      const auto      count = qFromLittleEndian<quint32>(footer.constData() + 16);
+      const auto      flags = qFromLittleEndian<quint32>(footer.constData() + 20);
+      const bool has_header = (flags & 0x80000000);
+
+      // size includes the footer but not the header.
+      const auto total_size = size + (has_header ? APE_FOOTER_SIZE : 0);
+      if(size < APE_FOOTER_SIZE || total_size > ape_end - information.id3v2_size) return false;
+
+      if(read_tags)
+      {
+        if(!file.seek(ape_end - size)) return false;
+        parseAPEItems(file.read(size - APE_FOOTER_SIZE), count, information);
+      }
+
+      information.trailing_size += total_size;
+    }
+  }
+
+  // ID3v1 has the lowest priority, only fills the fields without value.
+  if(read_tags && !id3v1.isEmpty())
+  {
+    auto field = [&id3v1](const int start, const int length)
+    {
+      return QString::fromLatin1(id3v1.mid(start, length)).section(QChar('\0'), 0, 0).trimmed();
+    };
+
+    if(information.title.isEmpty())  information.title  = field(3, 30);
+    if(information.artist.isEmpty()) information.artist = field(33, 30);
+    if(information.album.isEmpty())  information.album  = field(63, 30);
+
+    // ID3v1.1 stores the track number in the last byte of the comment.
+    if(information.track == 0 && id3v1.at(125) == '\0' && id3v1.at(126) != '\0')
+    {
+      information.track = static_cast<unsigned char>(id3v1.at(126));
+    }
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+void parseFirstFrame(QFile &file, MP3File::Information &information)
+{
+  if(!file.seek(information.id3v2_size)) return;
+
+  const auto buffer = file.read(FRAME_SEARCH_SIZE);
+  const auto bytes  = reinterpret_cast<const unsigned char *>(buffer.constData());
+
+  for(int i = 0; i + 4 <= buffer.size(); ++i)
+  {
+    if(bytes[i] != 0xFF || (bytes[i + 1] & 0xE0) != 0xE0) continue;
+
+    const int version_bits    = (bytes[i + 1] >> 3) & 0x03;
+    const int layer_bits      = (bytes[i + 1] >> 1) & 0x03;
+    const int bitrate_index   = (bytes[i + 2] >> 4) & 0x0F;
+    const int samplerate_index= (bytes[i + 2] >> 2) & 0x03;
+    const int padding         = (bytes[i + 2] >> 1) & 0x01;
+    const int channel_mode    = (bytes[i + 3] >> 6) & 0x03;
+
+    // only MPEG layer III frames.
+    if(version_bits == 1 || layer_bits != 1 || samplerate_index == 3) continue;
+
+    const bool is_mpeg1 = (version_bits == 3);
+    const int  bitrate  = is_mpeg1 ? BITRATES_MPEG1[bitrate_index] : BITRATES_MPEG2[bitrate_index];
+    if(bitrate == 0) continue;
+
+    const int samplerate        = SAMPLERATES[version_bits][samplerate_index];
+    const int samples_per_frame = is_mpeg1 ? 1152 : 576;
+    const int frame_size        = (samples_per_frame / 8 * bitrate * 1000) / samplerate + padding;
+
+    // if the next frame is in the buffer it must be valid too, avoids false syncs.
+    if(i + frame_size + 2 <= buffer.size() && (bytes[i + frame_size] != 0xFF || (bytes[i + frame_size + 1] & 0xE0) != 0xE0)) continue;
+
+    information.samplerate        = samplerate;
+    information.channels          = (channel_mode == 3) ? 1 : 2;
+    information.bitrate           = bitrate;
+    information.samples_per_frame = samples_per_frame;
+    information.first_frame       = information.id3v2_size + i;
+
+    // Xing/Info header position depends on the version and channels.
+    const int xing_offset = is_mpeg1 ? (information.channels == 1 ? 21 : 36) : (information.channels == 1 ? 13 : 21);
+    const auto tag = buffer.mid(i + xing_offset, 4);
+
+    if(tag == "Xing" || tag == "Info")
+    {
+      long long position = i + xing_offset + 4;
+      if(position + 4 > buffer.size()) return;
+
+      const auto xing_flags = qFromBigEndian<quint32>(bytes + position);
+      position += 4;
+
+      if((xing_flags & 0x01) && position + 4 <= buffer.size())
+      {
+        information.frames = qFromBigEndian<quint32>(bytes + position);
+        position += 4;
+      }
+      if(xing_flags & 0x02) position += 4;   // bytes
+      if(xing_flags & 0x04) position += 100; // TOC
+      if(xing_flags & 0x08) position += 4;   // quality
+
+      // LAME extension, delay and padding are two 12 bits values.
+      if(position + 24 <= buffer.size() && buffer.mid(position, 4) == "LAME")
+      {
+        information.encoder_delay   = (bytes[position + 21] << 4) | (bytes[position + 22] >> 4);
+        information.encoder_padding = ((bytes[position + 22] & 0x0F) << 8) | bytes[position + 23];
+      }
+    }
+    else if(buffer.mid(i + 36, 4) == "VBRI" && i + 36 + 18 <= buffer.size())
+    {
+      information.frames = qFromBigEndian<quint32>(bytes + i + 36 + 14);
+    }
+
+    return;
+  }
+}
+
+//-----------------------------------------------------------------
+void appendSyncsafeInteger(QByteArray &data, const unsigned int value)
+{
+  data.append(static_cast<char>((value >> 21) & 0x7F));
+  data.append(static_cast<char>((value >> 14) & 0x7F));
+  data.append(static_cast<char>((value >>  7) & 0x7F));
+  data.append(static_cast<char>(value & 0x7F));
+}
+
+//-----------------------------------------------------------------
+void appendID3Frame(QByteArray &tag, const char *id, const QByteArray &data)
+{
+  tag.append(id, 4);
+  appendSyncsafeInteger(tag, data.size());
+  tag.append(2, '\0'); // flags
+  tag.append(data);
+}
+
+//-----------------------------------------------------------------
+void appendID3TextFrame(QByteArray &tag, const char *id, const QString &text)
+{
+  if(text.isEmpty()) return;
+
+  // encoding 3 is UTF-8.
+  appendID3Frame(tag, id, QByteArray(1, '\3') + text.toUtf8());
+}
+
+//-----------------------------------------------------------------
+QByteArray MP3File::id3v2_tag(const Information &information, const long long length, const int padding)
+{
+  // syncsafe integers can't hold sizes of 256 MB or more.
+  const int MAX_TAG_SIZE = 0x0FFFFFFF;
+
+  QByteArray frames;
+  appendID3TextFrame(frames, "TIT2", information.title);
+  appendID3TextFrame(frames, "TPE1", information.artist);
+  appendID3TextFrame(frames, "TALB", information.album);
+  if(information.track != 0) appendID3TextFrame(frames, "TRCK", QString::number(information.track));
+  if(information.disc != 0)  appendID3TextFrame(frames, "TPOS", QString::number(information.disc));
+  if(length > 0)             appendID3TextFrame(frames, "TLEN", QString::number(length));
+  appendID3TextFrame(frames, "TSSE", SOFTWARE_NAME);
+
+  if(!information.cover.isEmpty() && frames.size() + information.cover.size() + padding < MAX_TAG_SIZE - 64)
+  {
+    auto mime = information.cover_mime;
+    if(mime.isEmpty()) mime = pictureMimeType(information.cover);
+
+    QByteArray picture;
+    picture.reserve(information.cover.size() + mime.size() + 4);
+    picture.append('\0'); // Latin1 encoding
+    picture.append(mime.toLatin1());
+    picture.append('\0');
+    picture.append(static_cast<char>(FRONT_COVER_TYPE));
+    picture.append('\0'); // empty description
+    picture.append(information.cover);
+
+    appendID3Frame(frames, "APIC", picture);
+  }
+
+  QByteArray tag;
+  tag.reserve(ID3V2_HEADER_SIZE + frames.size() + padding);
+  tag.append("ID3\4\0\0", 6); // version 2.4.0 without flags
+  appendSyncsafeInteger(tag, frames.size() + padding);
+  tag.append(frames);
+  tag.append(padding, '\0');
+
+  return tag;
+}
+
+//-----------------------------------------------------------------
+bool MP3File::parse(const QString &file_name, Information &information)
+{
+  information = Information();
+
+  QFile file(file_name);
+  if(!file.open(QIODevice::ReadOnly)) return false;
+
+  information.file_size = file.size();
+
+  if(!parseID3v2(file, information, true)) return false;
+
+  if(!parseTrailingTags(file, information, true)) return false;
+
+  parseFirstFrame(file, information);
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool MP3File::parse_stream(const QString &file_name, Information &information)
+{
+  information = Information();
+
+  QFile file(file_name);
+  if(!file.open(QIODevice::ReadOnly)) return false;
+
+  information.file_size = file.size();
+
+  if(!parseID3v2(file, information, false)) return false;
+
+  if(!parseTrailingTags(file, information, false)) return false;
+
+  parseFirstFrame(file, information);
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+long long MP3File::duration(const Information &information)
+{
+  if(information.samplerate == 0 || information.bitrate == 0) return -1;
+
+  if(information.frames > 0)
+  {
+    const auto samples = information.frames * information.samples_per_frame - information.encoder_delay - information.encoder_padding;
+    return (std::max(0LL, samples) * 1000) / information.samplerate;
+  }
+
+  // without a Xing/Info/VBRI header the stream is constant bitrate, kbps are bits per millisecond.
+  const auto audio_size = information.file_size - information.first_frame - information.trailing_size;
+  return (std::max(0LL, audio_size) * 8) / information.bitrate;
+}
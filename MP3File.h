@@ -0,0 +1,97 @@
+/*
+ File: MP3File.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP3_FILE_H_
+#define MP3_FILE_H_
+
+// Qt
+#include <QByteArray>
+#include <QString>
+
+namespace MP3File
+{
+  /** \struct Information
+   * \brief Tags and stream information of a MP3 file, obtained reading only the ID3v2 tag at the
+   *        start of the file, the first MPEG frame and the ID3v1/APE tags at the end of the file.
+   *
+   */
+  struct Information
+  {
+    long long  file_size;         /** size of the file in bytes.                                           */
+    long long  id3v2_size;        /** size of the ID3v2 tag at the start of the file, 0 if there isn't one. */
+    long long  trailing_size;     /** size of the APE and ID3v1 tags at the end of the file, 0 if none.    */
+    QString    title;             /** track title.                                                         */
+    QString    artist;            /** track artist.                                                        */
+    QString    album;             /** album title.                                                         */
+    int        track;             /** track number, 0 if unknown.                                          */
+    int        disc;              /** disc number, 0 if unknown.                                           */
+    QByteArray cover;             /** cover picture contents, empty if there isn't one.                    */
+    QString    cover_mime;        /** cover picture mime type.                                             */
+    int        samplerate;        /** sample rate of the first frame, 0 if no frame was found.             */
+    int        channels;          /** number of channels of the first frame.                               */
+    int        bitrate;           /** bitrate of the first frame in kbps.                                  */
+    int        samples_per_frame; /** number of samples of every frame.                                    */
+    long long  first_frame;       /** position of the first frame in the file.                             */
+    long long  frames;            /** number of frames from the Xing/Info/VBRI header, 0 if there isn't one. */
+    int        encoder_delay;     /** encoder delay in samples from the LAME tag, 0 if unknown.            */
+    int        encoder_padding;   /** encoder padding in samples from the LAME tag, 0 if unknown.          */
+    bool       own_tag;           /** true if the ID3v2 tag was written by this program.                    */
+
+    Information()
+    : file_size{0}, id3v2_size{0}, trailing_size{0}, track{0}, disc{0}, samplerate{0}, channels{0}, bitrate{0}
+    , samples_per_frame{0}, first_frame{0}, frames{0}, encoder_delay{0}, encoder_padding{0}, own_tag{false}
+    {};
+  };
+
+  /** \brief Parses the tags and the first frame of the given MP3 file. Returns false if the file
+   *         can't be read or the tags are malformed or use unsupported features.
+   * \param[in] file_name MP3 file name with absolute path.
+   * \param[out] information information struct.
+   *
+   */
+  bool parse(const QString &file_name, Information &information);
+
+  /** \brief Parses the stream information of the given MP3 file, the tags are only skipped. Returns
+   *         false if the file can't be read or the tags are malformed.
+   * \param[in] file_name MP3 file name with absolute path.
+   * \param[out] information information struct, without the tags fields.
+   *
+   */
+  bool parse_stream(const QString &file_name, Information &information);
+
+  /** \brief Returns the duration of the stream in milliseconds, from the frames of the Xing/Info/VBRI
+   *         header or from the bitrate of the first frame if there isn't one. Returns -1 if the
+   *         information doesn't have a frame.
+   * \param[in] information information struct.
+   *
+   */
+  long long duration(const Information &information);
+
+  /** \brief Returns an ID3v2.4 tag with the title, artist, album, track, disc and cover of the given
+   *         information, followed by the given bytes of padding. The tag is marked as written by this
+   *         program.
+   * \param[in] information tags information.
+   * \param[in] length track length in milliseconds, 0 to omit it.
+   * \param[in] padding number of padding bytes at the end of the tag.
+   *
+   */
+  QByteArray id3v2_tag(const Information &information, const long long length, const int padding);
+}
+
+#endif // MP3_FILE_H_
@@ -19,6 +19,7 @@
 
 // Project
 #include "MP3Worker.h"
+#include "DirectoryIndex.h"
 
 // tagparser
 #include <tagparser/diagnostics.h>
@@ -27,16 +28,18 @@
 #include <tagparser/tag.h>
 
 // Qt
+#include <QSaveFile>
 #include <QTemporaryFile>
 #include <QUuid>
 
 // C++
+#include <algorithm>
 #include <memory>
 
-QMutex MP3Worker::s_mutex;
-
 QString MP3Worker::MP3_EXTENSION = ".mp3";
 
+const long long COPY_BLOCK_SIZE = 1024*1024;
+
 //-----------------------------------------------------------------
 MP3Worker::MP3Worker(const QFileInfo &source_info, const Utils::TranscoderConfiguration &configuration)
 : AudioWorker(source_info, configuration)
@@ -47,9 +50,101 @@ MP3Worker::MP3Worker(const QFileInfo &source_info, const Utils::TranscoderConfig
 void MP3Worker::run_implementation()
 {
   const auto file_name = QDir::fromNativeSeparators(m_source_info.absoluteFilePath());
-  const auto shortName = Utils::shortFileName(QDir::toNativeSeparators(file_name));
 
   QString track_title;
+  bool has_tags = false;
+  long long duration = -1;
+
+  MP3File::Information information;
+  const bool parsed = MP3File::parse(m_source_info.absoluteFilePath(), information);
+  if(parsed)
+  {
+    has_tags = (information.id3v2_size > 0 || information.trailing_size > 0);
+    duration = MP3File::duration(information);
+
+    if(!information.cover.isEmpty() && m_configuration.extractMetadataCoverPicture())
+    {
+      save_cover_picture(information.cover, cover_extension(information.cover_mime));
+    }
+
+    emit progress(25);
+
+    if(m_configuration.useMetadataToRenameOutput())
+    {
+      Metadata metadata;
+      metadata.title  = information.title;
+      metadata.artist = information.artist;
+      metadata.track  = information.track;
+      metadata.disc   = information.disc;
+
+      track_title = metadata_file_name(metadata);
+    }
+  }
+  else
+  {
+    has_tags = parse_all_tags(track_title);
+  }
+
+  emit progress(50);
+
+  // the tags written to the outputs of previous runs are kept.
+  if(has_tags && m_configuration.stripTagsFromMp3() && !information.own_tag)
+  {
+    if(parsed)
+    {
+      strip_tags(information);
+    }
+    else
+    {
+      strip_tags();
+    }
+  }
+
+  emit progress(75);
+
+  if(track_title.isEmpty())
+  {
+    track_title = file_name.split('/').last().remove(MP3_EXTENSION);
+  }
+  track_title = m_configuration.formatProgram().apply(track_title, false);
+
+  auto source_name = file_name.split('/').last();
+  if(track_title.compare(source_name, Qt::CaseSensitive) != 0)
+  {
+    emit information_message(QString("Renaming '%1' from '%2'.").arg(track_title).arg(source_name));
+
+    const auto final_name = m_source_path + track_title;
+
+    if(!QFile::rename(m_source_info.absoluteFilePath(), final_name))
+    {
+      emit error_message(QString("Couldn't rename file '%1' to '%2'.").arg(m_source_info.absoluteFilePath()).arg(final_name));
+    }
+    else
+    {
+      DirectoryIndex::remove_output(m_source_info.absoluteFilePath());
+      DirectoryIndex::add_output(final_name, duration);
+
+      m_index_name = final_name;
+      m_output_files << track_title;
+    }
+  }
+  else
+  {
+    emit information_message(QString("Renaming not needed for '%1'.").arg(track_title));
+
+    DirectoryIndex::add_output(m_source_info.absoluteFilePath(), duration);
+
+    // the source is its own output.
+    m_output_files << source_name;
+  }
+
+  emit progress(100);
+}
+
+//-----------------------------------------------------------------
+bool MP3Worker::parse_all_tags(QString &track_title)
+{
+  const auto shortName = Utils::shortFileName(QDir::toNativeSeparators(m_source_info.absoluteFilePath()));
 
   TagParser::MediaFileInfo fileInfo(shortName);
   fileInfo.setForceFullParse(true);
@@ -105,53 +200,101 @@ void MP3Worker::run_implementation()
     track_title = parse_metadata(tags);
   }
 
-  emit progress(50);
+  if(fileInfo.isOpen()) fileInfo.close();
 
-  if(tags && m_configuration.stripTagsFromMp3())
-  {
-    TagParser::AbortableProgressFeedback::Callback nullCallback;;
+  return tags != nullptr;
+}
+
+//-----------------------------------------------------------------
+void MP3Worker::strip_tags()
+{
+  const auto shortName = Utils::shortFileName(QDir::toNativeSeparators(m_source_info.absoluteFilePath()));
 
+  TagParser::MediaFileInfo fileInfo(shortName);
+  TagParser::Diagnostics diag;
+  TagParser::AbortableProgressFeedback::Callback nullCallback;
+  TagParser::AbortableProgressFeedback progress(nullCallback, nullCallback);
+
+  try
+  {
+    fileInfo.open();
+    fileInfo.parseContainerFormat(diag, progress);
+    fileInfo.parseTags(diag, progress);
     fileInfo.removeAllTags();
-    TagParser::AbortableProgressFeedback progress(nullCallback, nullCallback);
-    try
-    {
-      fileInfo.applyChanges(diag, progress);
-      QFile::remove(QString::fromStdString(shortName) + ".bak");
-    }
-    catch(...)
-    {
-      emit error_message(tr("Unable to remove tags from %1.").arg(m_source_info.absoluteFilePath()));
-    }
+    fileInfo.applyChanges(diag, progress);
+    QFile::remove(QString::fromStdString(shortName) + ".bak");
+  }
+  catch(...)
+  {
+    emit error_message(tr("Unable to remove tags from %1.").arg(m_source_info.absoluteFilePath()));
   }
 
   if(fileInfo.isOpen()) fileInfo.close();
+}
 
-  emit progress(75);
+//-----------------------------------------------------------------
+void MP3Worker::strip_tags(const MP3File::Information &information)
+{
+  const auto audio_size = information.file_size - information.id3v2_size - information.trailing_size;
 
-  if(track_title.isEmpty())
+  // only trailing tags, they are removed by truncating the file.
+  if(information.id3v2_size == 0)
   {
-    track_title = file_name.split('/').last().remove(MP3_EXTENSION);
+    QFile file(m_source_info.absoluteFilePath());
+    if(!file.open(QIODevice::ReadWrite) || !file.resize(audio_size))
+    {
+      emit error_message(tr("Unable to truncate %1 to remove the tags.").arg(m_source_info.absoluteFilePath()));
+      return;
+    }
+
+    file.close();
+
+    emit information_message(QString("Removed %1 bytes of tags from '%2'.").arg(information.file_size - audio_size).arg(m_source_info.fileName()));
+    return;
   }
-  track_title = Utils::formatString(track_title, m_configuration.formatConfiguration());
 
-  auto source_name = file_name.split('/').last();
-  if(track_title.compare(source_name, Qt::CaseSensitive) != 0)
+  QFile source(m_source_info.absoluteFilePath());
+  if(!source.open(QIODevice::ReadOnly) || !source.seek(information.id3v2_size))
   {
-    emit information_message(QString("Renaming '%1' from '%2'.").arg(track_title).arg(source_name));
+    emit error_message(tr("Unable to remove tags from %1.").arg(m_source_info.absoluteFilePath()));
+    return;
+  }
 
-    const auto final_name = m_source_path + track_title;
+  // the audio data is written to a temporary file that replaces the source when complete, an interruption
+  // leaves the source untouched.
+  QSaveFile file(m_source_info.absoluteFilePath());
+  if(!file.open(QIODevice::WriteOnly))
+  {
+    emit error_message(tr("Unable to remove tags from %1.").arg(m_source_info.absoluteFilePath()));
+    return;
+  }
 
-    if(!QFile::rename(m_source_info.absoluteFilePath(), final_name))
+  QByteArray buffer(COPY_BLOCK_SIZE, 0);
+  long long bytes_written = 0;
+
+  while(bytes_written < audio_size)
+  {
+    const auto size = std::min<long long>(COPY_BLOCK_SIZE, audio_size - bytes_written);
+
+    if(source.read(buffer.data(), size) != size || file.write(buffer.constData(), size) != size)
     {
-      emit error_message(QString("Couldn't rename file '%1' to '%2'.").arg(m_source_info.absoluteFilePath()).arg(final_name));
+      file.cancelWriting();
+      emit error_message(tr("Error removing tags from %1.").arg(m_source_info.absoluteFilePath()));
+      return;
     }
+
+    bytes_written += size;
   }
-  else
+
+  source.close();
+
+  if(!file.commit())
   {
-    emit information_message(QString("Renaming not needed for '%1'.").arg(track_title));
+    emit error_message(tr("Unable to replace %1 to remove the tags.").arg(m_source_info.absoluteFilePath()));
+    return;
   }
 
-  emit progress(100);
+  emit information_message(QString("Removed %1 bytes of tags from '%2', %3 bytes written.").arg(information.file_size - audio_size).arg(m_source_info.fileName()).arg(bytes_written));
 }
 
 //-----------------------------------------------------------------
@@ -161,46 +304,29 @@ void MP3Worker::extract_cover(const TagParser::Tag *tag)
 
   const auto cover = tag->value(TagParser::KnownField::Cover);
 
-  const auto name = m_configuration.coverPictureName();
-  QString extension = "picture_unknown_format";
-
-  auto mime = QString::fromStdString(cover.mimeType());
+  const QByteArray data(cover.dataPointer(), cover.dataSize());
+  save_cover_picture(data, cover_extension(QString::fromStdString(cover.mimeType())));
+}
 
+//-----------------------------------------------------------------
+QString MP3Worker::cover_extension(const QString &mime)
+{
   if(mime.contains("jpg") || mime.contains("jpeg"))
   {
-    extension = ".jpg";
+    return ".jpg";
   }
   else if(mime.contains("png"))
   {
-    extension = ".png";
+    return ".png";
   }
   else if(mime.contains("bmp"))
   {
-    extension = ".bmp";
+    return ".bmp";
   }
   else if(mime.contains("tiff"))
   {
-    extension = ".tif";
+    return ".tif";
   }
 
-  const auto cover_name = m_source_path + name + extension;
-  {
-    // if there are several files with the same cover I just need one of the workers to dump the cover, not all of them.
-    QMutexLocker lock(&s_mutex);
-    if (!QFile::exists(cover_name))
-    {
-      QFile file(cover_name);
-      if (!file.open(QIODevice::WriteOnly|QIODevice::Append))
-      {
-        emit error_message(QString("Couldn't create cover picture file for '%1', check for file permissions.").arg(m_source_info.absoluteFilePath()));
-      }
-      else
-      {
-        file.write(cover.dataPointer(), cover.dataSize());
-        file.waitForBytesWritten(-1);
-        file.flush();
-        file.close();
-      }
-    }
-  }
+  return ".picture_unknown_format";
 }
@@ -22,9 +22,7 @@
 
 // Project
 #include "AudioWorker.h"
-
-// Qt
-#include <QMutex>
+#include "MP3File.h"
 
 namespace TagParser
 {
@@ -65,7 +63,30 @@ class MP3Worker
      */
     void extract_cover(const TagParser::Tag *tag);
 
-    static QMutex s_mutex; /** mutex for cover extraction. */
+    /** \brief Parses every tag of the file with TagParser to extract the cover and the track title. Used
+     *         when the file tags can't be read with MP3File. Returns true if the file has tags.
+     * \param[out] track_title track title obtained from the metadata, if enabled in the configuration.
+     *
+     */
+    bool parse_all_tags(QString &track_title);
+
+    /** \brief Removes all the tags from the source file using TagParser, which rewrites the whole file.
+     *
+     */
+    void strip_tags();
+
+    /** \brief Removes the tags from the source file. If there are only APE and ID3v1 tags the file is
+     *         truncated in place, otherwise the audio data is copied to a temporary file that replaces it.
+     * \param[in] information MP3 file information with the tags position.
+     *
+     */
+    void strip_tags(const MP3File::Information &information);
+
+    /** \brief Returns the cover picture file extension for the given mime type.
+     * \param[in] mime picture mime type.
+     *
+     */
+    static QString cover_extension(const QString &mime);
 };
 
 #endif // MP3_WORKER_H_
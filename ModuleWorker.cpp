@@ -149,7 +149,10 @@ void ModuleWorker::process_module()
         }
       }
 
-      encode(0, count, reinterpret_cast<unsigned char *>(&m_left_buffer), reinterpret_cast<unsigned char *>(&m_right_buffer));
+      if(!encode_samples(count, reinterpret_cast<unsigned char *>(&m_left_buffer), reinterpret_cast<unsigned char *>(&m_right_buffer)))
+      {
+        break;
+      }
     }
   }
 
@@ -166,7 +169,10 @@ Worker::Destinations ModuleWorker::compute_destinations()
 {
   Destinations destinations;
 
-  destinations << Destination(Utils::formatString(m_module_file_name, m_configuration.formatConfiguration()), 0);
+  // without metadata the name is the source file.
+  const auto is_file = (m_module_file_name == QDir::toNativeSeparators(m_source_info.absoluteFilePath()));
+
+  destinations << Destination(m_configuration.formatProgram().apply(m_module_file_name, is_file), 0, 0);
 
   return destinations;
 }
@@ -103,42 +103,10 @@ void MusicTranscoder::onDirectoryChanged()
 //-----------------------------------------------------------------
 void MusicTranscoder::onConversionStarted()
 {
-  QList<QFileInfo> files;
-  QList<QFileInfo> folders;
-
-  QStringList filters;
-  if(m_configuration.transcodeAudio())
-  {
-    filters << Utils::WAVE_FILE_EXTENSIONS;
-  }
-
-  if(m_configuration.transcodeVideo())
-  {
-    filters << Utils::MOVIE_FILE_EXTENSIONS;
-  }
-
-  if(m_configuration.transcodeModule())
-  {
-    filters << Utils::MODULE_FILE_EXTENSIONS;
-  }
-
-  if(!filters.empty())
-  {
-    files = Utils::findFiles(m_directoryText->text(), filters);
-  }
-
-  if(m_configuration.createM3Ufiles())
-  {
-    auto foldersCondition = [](const QFileInfo &info) { return info.isDir(); };
-    folders = Utils::findFiles(m_directoryText->text(), QStringList(), true, foldersCondition);
-  }
-
-  folders << QFileInfo(m_directoryText->text());
-
-  if(files.empty() && folders.empty())
+  if(!QDir(m_directoryText->text()).exists())
   {
     QMessageBox msgBox;
-    msgBox.setText("Can't find any file in the specified folder that can be processed.");
+    msgBox.setText("The specified folder doesn't exist.");
     msgBox.setStandardButtons(QMessageBox::Ok);
     msgBox.setIcon(QMessageBox::Information);
     msgBox.setWindowIcon(QIcon(":/MusicTranscoder/application.svg"));
@@ -150,7 +118,8 @@ void MusicTranscoder::onConversionStarted()
 
   this->hide();
 
-  ProcessDialog processDialog(files, folders, m_configuration);
+  // the directory is scanned by the dialog while transcoding.
+  ProcessDialog processDialog(m_directoryText->text(), m_configuration);
   processDialog.exec();
 
   this->showNormal();
@@ -0,0 +1,394 @@
+/*
+ File: PCMWorker.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "PCMWorker.h"
+
+// Qt
+#include <QtEndian>
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+const unsigned short WAVE_FORMAT_PCM        = 0x0001;
+const unsigned short WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+const unsigned short WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+//-----------------------------------------------------------------
+double extendedToDouble(const unsigned char *bytes)
+{
+  // 80 bit IEEE 754 extended precision number, used for the sample rate in AIFF files.
+  const int exponent = ((bytes[0] & 0x7F) << 8) | bytes[1];
+
+  unsigned long long mantissa = 0;
+  for(int i = 2; i < 10; ++i)
+  {
+    mantissa = (mantissa << 8) | bytes[i];
+  }
+
+  if(exponent == 0 && mantissa == 0) return 0;
+
+  return std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+}
+
+//-----------------------------------------------------------------
+PCMWorker::PCMWorker(const QFileInfo &source_info, const Utils::TranscoderConfiguration &configuration)
+: AudioWorker(source_info, configuration)
+{
+}
+
+//-----------------------------------------------------------------
+void PCMWorker::run_implementation()
+{
+  if(!init_pcm())
+  {
+    // let libav deal with it.
+    if(m_pcm_file.isOpen()) m_pcm_file.close();
+
+    m_information = Source_Info();
+    AudioWorker::run_implementation();
+    return;
+  }
+
+  process_pcm();
+
+  m_pcm_file.close();
+}
+
+//-----------------------------------------------------------------
+bool PCMWorker::init_pcm()
+{
+  m_pcm_file.setFileName(m_source_info.absoluteFilePath());
+  if(!m_pcm_file.open(QIODevice::ReadOnly))
+  {
+    return false;
+  }
+
+  const auto header = m_pcm_file.read(12);
+  if(header.size() != 12) return false;
+
+  const auto id     = header.left(4);
+  const auto format = header.mid(8, 4);
+
+  bool parsed = false;
+  if((id == "RIFF" || id == "RF64") && format == "WAVE")
+  {
+    parsed = parse_riff(id == "RF64");
+  }
+  else if(id == "FORM" && (format == "AIFF" || format == "AIFC"))
+  {
+    parsed = parse_aiff(format == "AIFC");
+  }
+
+  if(!parsed || m_pcm.data_offset < 0 || m_information.samplerate <= 0) return false;
+
+  // lame can only encode mono and stereo.
+  if(m_information.num_channels < 1 || m_information.num_channels > 2) return false;
+
+  const bool mono = (m_information.num_channels == 1);
+  if(m_pcm.is_float)
+  {
+    switch(m_pcm.bits)
+    {
+      case 32: m_information.format = mono ? Sample_format::FLOAT_PLANAR : Sample_format::FLOAT; break;
+      case 64: m_information.format = mono ? Sample_format::DOUBLE_PLANAR : Sample_format::DOUBLE; break;
+      default: return false;
+    }
+  }
+  else
+  {
+    switch(m_pcm.bits)
+    {
+      case 16: m_information.format = mono ? Sample_format::SIGNED_16_PLANAR : Sample_format::SIGNED_16; break;
+      case 24:
+      case 32: m_information.format = Sample_format::SIGNED_32_PLANAR; break;
+      default: return false;
+    }
+  }
+
+  m_pcm.bytes_per_frame = m_information.num_channels * (m_pcm.bits / 8);
+  m_pcm.data_size       = std::min(m_pcm.data_size, m_pcm_file.size() - m_pcm.data_offset);
+  m_pcm.data_size      -= m_pcm.data_size % m_pcm.bytes_per_frame;
+
+  if(m_pcm.data_size <= 0) return false;
+
+  if(!is_direct())
+  {
+    m_left.resize(BATCH_SAMPLES);
+    m_right.resize(BATCH_SAMPLES);
+  }
+
+  m_information.init   = true;
+  m_information.isFlac = false;
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool PCMWorker::parse_riff(const bool is_rf64)
+{
+  long long ds64_data_size = -1;
+  bool      has_format     = false;
+
+  while(!m_pcm_file.atEnd())
+  {
+    const auto header = m_pcm_file.read(8);
+    if(header.size() != 8) break;
+
+    const auto id          = header.left(4);
+    const long long size   = qFromLittleEndian<quint32>(header.constData() + 4);
+    const auto chunk_start = m_pcm_file.pos();
+
+    if(id == "ds64")
+    {
+      const auto data = m_pcm_file.read(std::min(size, 28LL));
+      if(data.size() < 16) return false;
+
+      ds64_data_size = static_cast<long long>(qFromLittleEndian<quint64>(data.constData() + 8));
+    }
+    else if(id == "fmt ")
+    {
+      const auto data = m_pcm_file.read(std::min(size, 64LL));
+      if(data.size() < 16) return false;
+
+      auto format_tag = qFromLittleEndian<quint16>(data.constData());
+      if(format_tag == WAVE_FORMAT_EXTENSIBLE && data.size() >= 26)
+      {
+        // first two bytes of the sub-format GUID are the format tag.
+        format_tag = qFromLittleEndian<quint16>(data.constData() + 24);
+      }
+
+      if(format_tag != WAVE_FORMAT_PCM && format_tag != WAVE_FORMAT_IEEE_FLOAT) return false;
+
+      m_information.num_channels = qFromLittleEndian<quint16>(data.constData() + 2);
+      m_information.samplerate   = qFromLittleEndian<quint32>(data.constData() + 4);
+      m_pcm.bits                 = qFromLittleEndian<quint16>(data.constData() + 14);
+      m_pcm.is_float             = (format_tag == WAVE_FORMAT_IEEE_FLOAT);
+      m_pcm.big_endian           = false;
+      has_format = true;
+    }
+    else if(id == "data")
+    {
+      m_pcm.data_offset = chunk_start;
+      m_pcm.data_size   = (is_rf64 && size == 0xFFFFFFFF) ? ds64_data_size : size;
+
+      if(has_format) break;
+    }
+
+    // chunks are word aligned.
+    if(!m_pcm_file.seek(chunk_start + size + (size & 1))) break;
+  }
+
+  return has_format;
+}
+
+//-----------------------------------------------------------------
+bool PCMWorker::parse_aiff(const bool is_aifc)
+{
+  bool has_format = false;
+
+  while(!m_pcm_file.atEnd())
+  {
+    const auto header = m_pcm_file.read(8);
+    if(header.size() != 8) break;
+
+    const auto id          = header.left(4);
+    const long long size   = qFromBigEndian<quint32>(header.constData() + 4);
+    const auto chunk_start = m_pcm_file.pos();
+
+    if(id == "COMM")
+    {
+      const auto data = m_pcm_file.read(std::min(size, 22LL));
+      if(data.size() < 18) return false;
+
+      m_information.num_channels = qFromBigEndian<quint16>(data.constData());
+      m_pcm.bits                 = qFromBigEndian<quint16>(data.constData() + 6);
+      m_information.samplerate   = std::lround(extendedToDouble(reinterpret_cast<const unsigned char *>(data.constData() + 8)));
+      m_pcm.big_endian           = true;
+      m_pcm.is_float             = false;
+
+      if(is_aifc)
+      {
+        if(data.size() < 22) return false;
+
+        const auto compression = data.mid(18, 4);
+        if(compression == "sowt")
+        {
+          m_pcm.big_endian = false;
+        }
+        else if(compression == "fl32" || compression == "FL32" || compression == "fl64" || compression == "FL64")
+        {
+          m_pcm.is_float = true;
+        }
+        else if(compression != "NONE")
+        {
+          return false;
+        }
+      }
+
+      has_format = true;
+    }
+    else if(id == "SSND")
+    {
+      const auto data = m_pcm_file.read(8);
+      if(data.size() != 8) return false;
+
+      const long long offset = qFromBigEndian<quint32>(data.constData());
+      m_pcm.data_offset = chunk_start + 8 + offset;
+      m_pcm.data_size   = size - 8 - offset;
+
+      if(has_format) break;
+    }
+
+    // chunks are word aligned.
+    if(!m_pcm_file.seek(chunk_start + size + (size & 1))) break;
+  }
+
+  return has_format;
+}
+
+//-----------------------------------------------------------------
+bool PCMWorker::is_direct() const
+{
+  return m_information.format != Sample_format::SIGNED_32_PLANAR;
+}
+
+//-----------------------------------------------------------------
+void PCMWorker::convert_block(const unsigned char *data, const unsigned int frames, unsigned char *&buffer1, unsigned char *&buffer2)
+{
+  const auto channels = m_information.num_channels;
+
+  if(is_direct())
+  {
+    buffer1 = const_cast<unsigned char *>(data);
+
+    if(m_pcm.big_endian)
+    {
+      // swap in place in the conversion buffers, the file mapping is read only.
+      const auto samples = frames * channels;
+      m_left.resize(std::max<size_t>(m_left.size(), (samples * (m_pcm.bits / 8) + sizeof(long int) - 1) / sizeof(long int)));
+      switch(m_pcm.bits)
+      {
+        case 16: qFromBigEndian<quint16>(data, samples, m_left.data()); break;
+        case 32: qFromBigEndian<quint32>(data, samples, m_left.data()); break;
+        case 64: qFromBigEndian<quint64>(data, samples, m_left.data()); break;
+        default: break;
+      }
+      buffer1 = reinterpret_cast<unsigned char *>(m_left.data());
+    }
+
+    // lame ignores the second buffer if the input is mono or interleaved.
+    buffer2 = buffer1;
+    return;
+  }
+
+  // 24 and 32 bits integer samples are converted to full scale 32 bits planar buffers.
+  const auto bytes_per_sample = m_pcm.bits / 8;
+  for(unsigned int i = 0; i < frames; ++i)
+  {
+    for(int channel = 0; channel < channels; ++channel)
+    {
+      const auto sample = data + (i * channels + channel) * bytes_per_sample;
+      qint32 value = 0;
+
+      if(bytes_per_sample == 3)
+      {
+        if(m_pcm.big_endian)
+        {
+          value = static_cast<qint32>((quint32(sample[2]) << 8) | (quint32(sample[1]) << 16) | (quint32(sample[0]) << 24));
+        }
+        else
+        {
+          value = static_cast<qint32>((quint32(sample[0]) << 8) | (quint32(sample[1]) << 16) | (quint32(sample[2]) << 24));
+        }
+      }
+      else
+      {
+        value = m_pcm.big_endian ? qFromBigEndian<qint32>(sample) : qFromLittleEndian<qint32>(sample);
+      }
+
+      if(channel == 0) m_left[i]  = value;
+      else             m_right[i] = value;
+    }
+  }
+
+  buffer1 = reinterpret_cast<unsigned char *>(m_left.data());
+  buffer2 = reinterpret_cast<unsigned char *>(channels == 1 ? m_left.data() : m_right.data());
+}
+
+//-----------------------------------------------------------------
+void PCMWorker::process_pcm()
+{
+  auto data = m_pcm_file.map(m_pcm.data_offset, m_pcm.data_size);
+  if(!data)
+  {
+    emit error_message(QString("Couldn't map the data of '%1'. Error is: %2.").arg(m_source_info.absoluteFilePath()).arg(m_pcm_file.errorString()));
+    m_fail = true;
+    return;
+  }
+
+  if(!open_next_destination_file())
+  {
+    m_pcm_file.unmap(data);
+    m_fail = true;
+    return;
+  }
+
+  const long long total_frames = m_pcm.data_size / m_pcm.bytes_per_frame;
+  long long frame = 0;
+  int progressVal = 0;
+
+  while(frame < total_frames && !has_been_cancelled())
+  {
+    // blocks of the size of the batch are encoded from the mapping without copying them.
+    const auto frames = static_cast<unsigned int>(std::min<long long>(BATCH_SAMPLES, total_frames - frame));
+
+    unsigned char *buffer1 = nullptr;
+    unsigned char *buffer2 = nullptr;
+    convert_block(data + frame * m_pcm.bytes_per_frame, frames, buffer1, buffer2);
+
+    if(!encode_samples(frames, buffer1, buffer2))
+    {
+      m_fail = true;
+      break;
+    }
+
+    frame += frames;
+
+    const int currentProgress = (frame * 100) / total_frames;
+    if(progressVal != currentProgress)
+    {
+      progressVal = currentProgress;
+      emit progress(progressVal);
+    }
+  }
+
+  m_pcm_file.unmap(data);
+
+  if(has_failed() || has_been_cancelled()) return;
+
+  if(!close_destination_file()) return;
+
+  // the size of the data gives the exact number of samples of the source.
+  if(m_configuration.verifyCueSplit() && number_of_tracks() > 1)
+  {
+    verify_split(total_frames);
+  }
+}
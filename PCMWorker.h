@@ -0,0 +1,117 @@
+/*
+ File: PCMWorker.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCM_WORKER_H_
+#define PCM_WORKER_H_
+
+// Project
+#include "AudioWorker.h"
+
+// C++
+#include <vector>
+
+/** \class PCMWorker
+ * \brief Implements a Worker for uncompressed WAV/RF64/AIFF files that reads the samples
+ *        directly from the file without using libav. Falls back to the AudioWorker
+ *        implementation if the file can't be handled.
+ *
+ */
+class PCMWorker
+: public AudioWorker
+{
+    Q_OBJECT
+  public:
+    /** \brief PCMWorker class constructor.
+     * \param[in] source_info QFileInfo struct of the source file.
+     * \param[in] configuration configuration struct reference.
+     *
+     */
+    explicit PCMWorker(const QFileInfo &source_info, const Utils::TranscoderConfiguration &configuration);
+
+    /** \brief PCMWorker class virtual destructor.
+     *
+     */
+    virtual ~PCMWorker()
+    {}
+
+  protected:
+    virtual void run_implementation() override final;
+
+  private:
+    /** \struct PCM_Info
+     * \brief Information of the data chunk of the source file.
+     *
+     */
+    struct PCM_Info
+    {
+      long long data_offset;     /** position of the first sample in the file.     */
+      long long data_size;       /** size of the samples data in bytes.            */
+      int       bits;            /** bits per sample.                              */
+      int       bytes_per_frame; /** bytes of a sample of all the channels.        */
+      bool      is_float;        /** true if samples are IEEE floats.              */
+      bool      big_endian;      /** true if samples are stored in big endian.     */
+
+      PCM_Info(): data_offset{-1}, data_size{0}, bits{0}, bytes_per_frame{0}, is_float{false}, big_endian{false} {};
+    };
+
+    /** \brief Parses the header of the file and fills the source information. Returns true if the
+     *         file can be processed without libav and false otherwise.
+     *
+     */
+    bool init_pcm();
+
+    /** \brief Parses the chunks of a RIFF or RF64 WAVE file.
+     * \param[in] is_rf64 true if the file is RF64 and false if it's a RIFF file.
+     *
+     */
+    bool parse_riff(const bool is_rf64);
+
+    /** \brief Parses the chunks of an AIFF or AIFC file.
+     * \param[in] is_aifc true if the file is AIFC and false if it's AIFF.
+     *
+     */
+    bool parse_aiff(const bool is_aifc);
+
+    /** \brief Encodes the samples in the data chunk of the file.
+     *
+     */
+    void process_pcm();
+
+    /** \brief Converts a block of samples to a format the encoder accepts, if needed. Returns
+     *         the pointers to the buffers to encode.
+     * \param[in] data pointer to the block of samples in the file.
+     * \param[in] frames number of samples per channel in the block.
+     * \param[out] buffer1 first buffer to encode.
+     * \param[out] buffer2 second buffer to encode.
+     *
+     */
+    void convert_block(const unsigned char *data, const unsigned int frames, unsigned char *&buffer1, unsigned char *&buffer2);
+
+    /** \brief Returns true if the samples can be encoded directly from the file data.
+     *
+     */
+    bool is_direct() const;
+
+    QFile                   m_pcm_file; /** source file.                    */
+    PCM_Info                m_pcm;      /** source data information.        */
+    std::vector<long int>   m_left;     /** left channel conversion buffer. */
+    std::vector<long int>   m_right;    /** right channel conversion buffer.*/
+};
+
+#endif // PCM_WORKER_H_
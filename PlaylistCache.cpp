@@ -0,0 +1,145 @@
+/*
+ File: PlaylistCache.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "PlaylistCache.h"
+
+// Qt
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+const quint32 PlaylistCache::MAGIC   = 0x4D33554Cu; // "M3UL"
+const quint32 PlaylistCache::VERSION = 1;
+
+QMutex                                PlaylistCache::s_mutex;
+bool                                  PlaylistCache::s_loaded   = false;
+bool                                  PlaylistCache::s_modified = false;
+QHash<QString, PlaylistCache::Folder> PlaylistCache::s_folders;
+
+//-----------------------------------------------------------------
+bool PlaylistCache::folder(const QString &directory, Folder &folder)
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(!s_loaded) load();
+
+  const auto it = s_folders.constFind(directory);
+  if(it == s_folders.constEnd()) return false;
+
+  folder = it.value();
+  return true;
+}
+
+//-----------------------------------------------------------------
+void PlaylistCache::set_folder(const QString &directory, const Folder &folder)
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(!s_loaded) load();
+
+  s_folders.insert(directory, folder);
+  s_modified = true;
+}
+
+//-----------------------------------------------------------------
+void PlaylistCache::save()
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(!s_modified) return;
+
+  QDir().mkpath(QFileInfo(file_name()).absolutePath());
+
+  // written to a temporary file and renamed, an interrupted save doesn't lose the previous cache.
+  QSaveFile file(file_name());
+  if(!file.open(QIODevice::WriteOnly)) return;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_6_0);
+  stream << MAGIC << VERSION << static_cast<qint64>(s_folders.size());
+
+  for(auto it = s_folders.cbegin(); it != s_folders.cend(); ++it)
+  {
+    stream << it.key() << it.value().fingerprint << static_cast<qint64>(it.value().files.size());
+
+    for(auto entry = it.value().files.cbegin(); entry != it.value().files.cend(); ++entry)
+    {
+      stream << entry.key() << static_cast<qint64>(entry.value().size) << static_cast<qint64>(entry.value().modified)
+             << static_cast<qint64>(entry.value().duration);
+    }
+  }
+
+  if(stream.status() == QDataStream::Ok && file.commit())
+  {
+    s_modified = false;
+  }
+}
+
+//-----------------------------------------------------------------
+void PlaylistCache::load()
+{
+  s_loaded = true;
+  s_folders.clear();
+
+  QFile file(file_name());
+  if(!file.open(QIODevice::ReadOnly)) return;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_6_0);
+
+  quint32 magic = 0, version = 0;
+  qint64  count = 0;
+  stream >> magic >> version >> count;
+  if(magic != MAGIC || version != VERSION) return;
+
+  for(qint64 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+  {
+    QString directory;
+    Folder  folder;
+    qint64  files = 0;
+    stream >> directory >> folder.fingerprint >> files;
+
+    for(qint64 j = 0; j < files && stream.status() == QDataStream::Ok; ++j)
+    {
+      QString name;
+      qint64  size = 0, modified = 0, duration = 0;
+      stream >> name >> size >> modified >> duration;
+
+      folder.files.insert(name, Entry{size, modified, duration});
+    }
+
+    s_folders.insert(directory, folder);
+  }
+
+  // a truncated or corrupted cache only means the playlists are written again.
+  if(stream.status() != QDataStream::Ok)
+  {
+    s_folders.clear();
+  }
+}
+
+//-----------------------------------------------------------------
+QString PlaylistCache::file_name()
+{
+  return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QString("/playlists.cache");
+}
@@ -0,0 +1,99 @@
+/*
+ File: PlaylistCache.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYLIST_CACHE_H_
+#define PLAYLIST_CACHE_H_
+
+// Qt
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/** \class PlaylistCache
+ * \brief Keeps between runs the fingerprint of the MP3 files of every folder with a playlist and
+ *        their durations, so the playlists of the folders that haven't changed aren't written again.
+ *        Stored in the application local data directory.
+ *
+ */
+class PlaylistCache
+{
+  public:
+    /** \struct Entry
+     * \brief MP3 file of a folder.
+     *
+     */
+    struct Entry
+    {
+      long long size;     /** size in bytes.                                     */
+      long long modified; /** modification time in milliseconds since the epoch. */
+      long long duration; /** duration in milliseconds.                          */
+    };
+
+    /** \struct Folder
+     * \brief MP3 files of a folder when its playlist was written.
+     *
+     */
+    struct Folder
+    {
+      QByteArray            fingerprint; /** hash of the playlist name and the names, sizes and times of the files. */
+      QHash<QString, Entry> files;       /** files of the folder by name.                                          */
+    };
+
+    /** \brief Returns true and the folder information if the folder is in the cache. The cache is
+     *         read from disk the first time.
+     * \param[in] directory directory path, with the separator at the end.
+     * \param[out] folder folder information.
+     *
+     */
+    static bool folder(const QString &directory, Folder &folder);
+
+    /** \brief Sets the information of the folder after writing its playlist.
+     * \param[in] directory directory path, with the separator at the end.
+     * \param[in] folder folder information.
+     *
+     */
+    static void set_folder(const QString &directory, const Folder &folder);
+
+    /** \brief Writes the cache to disk if it has been modified.
+     *
+     */
+    static void save();
+
+  private:
+    /** \brief Reads the cache from disk, an invalid cache file is ignored. The mutex must be locked.
+     *
+     */
+    static void load();
+
+    /** \brief Returns the absolute file name of the cache.
+     *
+     */
+    static QString file_name();
+
+    static const quint32 MAGIC;   /** cache file identifier. */
+    static const quint32 VERSION; /** cache file version.    */
+
+    static QMutex                 s_mutex;    /** protects the cache.                    */
+    static bool                   s_loaded;   /** true if the cache has been read.       */
+    static bool                   s_modified; /** true if the cache needs to be written. */
+    static QHash<QString, Folder> s_folders;  /** folders by path.                       */
+};
+
+#endif // PLAYLIST_CACHE_H_
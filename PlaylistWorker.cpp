@@ -20,19 +20,20 @@
 // Project
 #include "PlaylistWorker.h"
 #include "Utils.h"
+#include "DirectoryIndex.h"
+#include "MP3File.h"
+#include "PlaylistCache.h"
 
-// libav
-extern "C"
-{
-#include <libavformat/avformat.h>
-}
+// Qt
+#include <QCryptographicHash>
+#include <QFile>
 
 const QString PLAYLIST_EXTENSION = QString(".m3u8");
 const QChar   SEPARATOR          = QChar('/');
 
 //-----------------------------------------------------------------
 PlaylistWorker::PlaylistWorker(const QFileInfo &source_info, const Utils::TranscoderConfiguration& configuration)
-: AudioWorker(source_info, configuration)
+: Worker(source_info, configuration)
 {
 }
 
@@ -48,11 +49,23 @@ QStringList PlaylistWorker::get_file_names() const
   QStringList fileNames, filter;
   filter << QObject::tr("*.mp3");
 
-  auto files = Utils::findFiles(QDir(m_source_info.absoluteFilePath()), filter, false);
-
-  for(auto file: files)
+  // the index has the files found in the scan and the ones transcoded.
+  const auto directory = m_source_info.absoluteFilePath() + SEPARATOR;
+  if(DirectoryIndex::contains(directory))
+  {
+    for(const auto &file: DirectoryIndex::outputs(directory))
+    {
+      fileNames << directory + file;
+    }
+  }
+  else
   {
-    fileNames << file.absoluteFilePath();
+    auto files = Utils::findFiles(QDir(m_source_info.absoluteFilePath()), filter, false);
+
+    for(auto file: files)
+    {
+      fileNames << file.absoluteFilePath();
+    }
   }
 
   fileNames.sort();
@@ -74,8 +87,43 @@ void PlaylistWorker::generate_playlist()
   }
 
   auto playlistname = m_source_info.absoluteFilePath().split(SEPARATOR).last();
-  auto baseName = Utils::formatString(playlistname, m_configuration.formatConfiguration(), false);
-  QFile playlist(m_source_info.absoluteFilePath() + QDir::separator() + baseName + PLAYLIST_EXTENSION);
+  auto baseName = m_configuration.formatProgram().apply(playlistname, false, false);
+  const auto playlistFile = baseName + PLAYLIST_EXTENSION;
+
+  // the files modified or written after the scan don't have stamps.
+  const auto directory = m_source_info.absoluteFilePath() + SEPARATOR;
+  auto stamps = DirectoryIndex::stamps(directory);
+  for(const auto &file: files)
+  {
+    const auto name = file.split(SEPARATOR).last();
+    if(!stamps.contains(name))
+    {
+      const QFileInfo info(file);
+      stamps.insert(name, DirectoryIndex::Stamp(info.size(), info.lastModified().toMSecsSinceEpoch()));
+    }
+  }
+
+  const auto fingerprint = folder_fingerprint(playlistFile, files, stamps);
+
+  bool playlistExists = false;
+  if(DirectoryIndex::contains(directory))
+  {
+    playlistExists = DirectoryIndex::playlists(directory).contains(playlistFile, Qt::CaseInsensitive);
+  }
+  else
+  {
+    playlistExists = QFile::exists(directory + playlistFile);
+  }
+
+  PlaylistCache::Folder cached;
+  const bool isCached = PlaylistCache::folder(directory, cached);
+  if(isCached && playlistExists && cached.fingerprint == fingerprint)
+  {
+    emit information_message(QString("Playlist of %1%2 is up to date.").arg(dirName).arg(QDir::separator()));
+    return;
+  }
+
+  QFile playlist(m_source_info.absoluteFilePath() + QDir::separator() + playlistFile);
 
   if(!playlist.open(QFile::WriteOnly|QFile::Truncate))
   {
@@ -90,28 +138,60 @@ void PlaylistWorker::generate_playlist()
   QByteArray contents;
   contents.append((QString("#EXTM3U") + newline).toLocal8Bit());
 
+  const auto durations = DirectoryIndex::durations(directory);
+
+  PlaylistCache::Folder folder;
+  folder.fingerprint = fingerprint;
+
   int progressVal = 0;
-  for(auto file: files)
+  for(int i = 0; i < files.size(); ++i)
   {
-    const int currentProgress = ((files.indexOf(file) + 1) * 100) / files.size();
+    const auto &file = files.at(i);
+
+    const int currentProgress = ((i + 1) * 100) / files.size();
     if(progressVal != currentProgress)
     {
       progressVal = currentProgress;
       emit progress(progressVal);
     }
 
-    long long duration = 0;
-    if(has_been_cancelled() || !get_song_duration(file, duration))
+    const auto name  = file.split(SEPARATOR).last();
+    const auto stamp = stamps.value(name);
+
+    // transcoded in this run or unchanged since the last playlist, only the rest are parsed.
+    auto duration = durations.value(name, -1);
+    if(duration < 0 && isCached)
+    {
+      const auto entry = cached.files.constFind(name);
+      if(entry != cached.files.constEnd() && entry->size == stamp.size && entry->modified == stamp.modified)
+      {
+        duration = entry->duration;
+      }
+    }
+
+    if(has_been_cancelled())
     {
       playlist.close();
       playlist.remove();
       return;
     }
 
-    auto basename = file.split(SEPARATOR).last().toUtf8();
+    if(duration < 0)
+    {
+      duration = get_song_duration(file);
+    }
+
+    // the files without a known duration are parsed again in the next run.
+    if(duration >= 0)
+    {
+      folder.files.insert(name, PlaylistCache::Entry{stamp.size, stamp.modified, duration});
+    }
+
+    auto basename = name.toUtf8();
 
+    // -1 is the length of the entries with unknown duration.
     contents.append((QString("#EXTINF:") +
-                    QString().number(duration) +
+                    QString().number(duration < 0 ? -1 : duration / 1000) +
                     QString(",") +
                     basename.split('.').first() +
                     newline).toLocal8Bit());
@@ -121,57 +201,45 @@ void PlaylistWorker::generate_playlist()
 
   playlist.write(contents);
   playlist.close();
+
+  PlaylistCache::set_folder(directory, folder);
 }
 
 //-----------------------------------------------------------------
-bool PlaylistWorker::get_song_duration(const QString &file_name, long long &duration)
+long long PlaylistWorker::get_song_duration(const QString &file_name)
 {
-  QFile input_file(file_name);
-  if(!input_file.open(QIODevice::ReadOnly))
+  MP3File::Information information;
+  if(!MP3File::parse_stream(file_name, information))
   {
-    emit error_message(QString("Couldn't open input file '%1'.").arg(file_name));
-    return false;
+    emit error_message(QString("Couldn't read the headers of '%1', its length will be unknown in the playlist.").arg(file_name));
+    return -1;
   }
 
-  QMutexLocker lock(&s_mutex);
-
-  auto value = avformat_open_input(&m_libav_context, file_name.toStdString().c_str(), nullptr, nullptr);
-  if(value < 0)
+  // the frame is searched near the start of the file only, valid files can have it further.
+  const auto duration = MP3File::duration(information);
+  if(duration < 0)
   {
-    emit error_message(QString("Couldn't open file: '%1' with libav. Error is \"%2\"").arg(file_name).arg(av_error_string(value)));
-    deinit_libav();
-    m_fail = true;
-    return false;
+    emit error_message(QString("Couldn't find an audio frame in the first bytes of '%1', its length will be unknown in the playlist.").arg(file_name));
   }
 
-  // avoids a warning message from libav when the duration can't be calculated accurately. this increases the lookup frames.
-  m_libav_context->max_analyze_duration *= 1000;
+  return duration;
+}
 
-  value = avformat_find_stream_info(m_libav_context, nullptr);
-  if(value < 0)
-  {
-    emit error_message(QString("Couldn't get the information of '%1'. Error is \"%2\".").arg(file_name).arg(av_error_string(value)));
-    deinit_libav();
-    m_fail = true;
-    return false;
-  }
+//-----------------------------------------------------------------
+QByteArray PlaylistWorker::folder_fingerprint(const QString &playlist, const QStringList &files, const QHash<QString, DirectoryIndex::Stamp> &stamps)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(playlist.toUtf8());
 
-  AVCodec *dummy_decoder = nullptr;
-  auto stream_id = av_find_best_stream(m_libav_context, AVMEDIA_TYPE_AUDIO, -1, -1, const_cast<const AVCodec **>(&dummy_decoder), 0);
-  if (stream_id < 0)
+  for(const auto &file: files)
   {
-    emit error_message(QString("Couldn't find any audio stream in '%1'. Error is \"%2\".").arg(file_name).arg(av_error_string(stream_id)));
-    deinit_libav();
-    m_fail = true;
-    return false;
-  }
+    const auto name  = file.split(SEPARATOR).last();
+    const auto stamp = stamps.value(name);
 
-  auto stream = m_libav_context->streams[stream_id];
-  duration = (stream->duration * stream->time_base.num) / stream->time_base.den;
-
-  deinit_libav();
-
-  input_file.close();
+    hash.addData(QByteArray(1, '\0') + name.toUtf8());
+    hash.addData(QByteArrayView(reinterpret_cast<const char *>(&stamp.size), sizeof(stamp.size)));
+    hash.addData(QByteArrayView(reinterpret_cast<const char *>(&stamp.modified), sizeof(stamp.modified)));
+  }
 
-  return true;
+  return hash.result();
 }
@@ -21,14 +21,18 @@
 #define PLAYLIST_WORKER_H_
 
 // Project
-#include "AudioWorker.h"
+#include "Worker.h"
+#include "DirectoryIndex.h"
+
+// Qt
+#include <QHash>
 
 /** \class PlaylistWorker
  * \brief Implements a Worker that creates the playlists with file information.
  *
  */
 class PlaylistWorker
-: public AudioWorker
+: public Worker
 {
   public:
     /** \brief PlaylistWorker class constructor.
@@ -58,12 +62,20 @@ class PlaylistWorker
      */
     void generate_playlist();
 
-    /** \brief Returns true if the duration of the song passed as a parameter could be obtained.
+    /** \brief Returns the duration in milliseconds of the song passed as a parameter obtained from
+     *         its MP3 headers, or -1 if it couldn't be obtained.
      * \param[in] file_name name of a mp3 in the same folder, with extension.
-     * \param[out] duration duration of the song in seconds.
      *
      */
-    bool get_song_duration(const QString &file_name, long long &duration);
+    long long get_song_duration(const QString &file_name);
+
+    /** \brief Returns the hash of the playlist name and the names, sizes and times of the files.
+     * \param[in] playlist playlist file name.
+     * \param[in] files absolute file names of the MP3 files, sorted.
+     * \param[in] stamps stamps of the files by name.
+     *
+     */
+    static QByteArray folder_fingerprint(const QString &playlist, const QStringList &files, const QHash<QString, DirectoryIndex::Stamp> &stamps);
 };
 
 #endif // PLAYLIST_WORKER_H_
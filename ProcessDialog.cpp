@@ -22,8 +22,18 @@
 #include <MusicTranscoder.h>
 #include <AudioWorker.h>
 #include <MP3Worker.h>
+#include <PCMWorker.h>
 #include <ModuleWorker.h>
 #include <PlaylistWorker.h>
+#include <DirectoryScanner.h>
+#include <DirectoryIndex.h>
+#include <DirectoryContext.h>
+#include <FileClassifier.h>
+#include <CoverRegistry.h>
+#include <PlaylistCache.h>
+#include <LibraryIndex.h>
+#include <RunJournal.h>
+#include <FolderWatcher.h>
 
 // Qt
 #include <QObject>
@@ -45,18 +55,21 @@ extern "C"
 }
 
 //-----------------------------------------------------------------
-ProcessDialog::ProcessDialog(const QList<QFileInfo> &files,
-                             const QList<QFileInfo> &folders,
+ProcessDialog::ProcessDialog(const QString &root,
                              const Utils::TranscoderConfiguration &configuration,
                              QWidget *parent,
                              Qt::WindowFlags flags)
 : QDialog               {parent, flags}
-, m_music_files         {files}
-, m_music_folders       {folders}
+, m_root                {root}
 , m_num_workers         {0}
 , m_configuration       {configuration}
 , m_errorsCount         {0}
 , m_finished_transcoding{false}
+, m_scanner             {nullptr}
+, m_watcher             {nullptr}
+, m_scanning            {true}
+, m_stopped             {false}
+, m_total_jobs          {0}
 , m_taskBarButton       {this}
 {
   setupUi(this);
@@ -77,43 +90,64 @@ ProcessDialog::ProcessDialog(const QList<QFileInfo> &files,
   m_cancelButton->setToolTip(tr("Cancel transcoding process."));
 
   m_max_workers = m_configuration.numberOfThreads();
-  auto total_jobs = m_music_files.size() + m_music_folders.size();
 
-  m_globalProgress->setRange(0, total_jobs);
-  m_globalProgress->setValue(0);
-  m_taskBarButton.setRange(0,total_jobs);
-  m_taskBarButton.setValue(0);
+  Worker::set_threads_budget(m_max_workers);
+  Worker::set_pending_jobs(0);
+  Worker::reset_statistics();
+  Utils::FormatProgram::reset_statistics();
+  DirectoryIndex::clear();
+  DirectoryContext::clear();
+  FileClassifier::clear();
+  CoverRegistry::clear();
+
+  if(m_configuration.skipUnchangedFiles())
+  {
+    LibraryIndex::open(m_configuration);
+  }
+
+  const auto resume = RunJournal::open(m_root, m_configuration);
+  if(resume.resumed)
+  {
+    m_log->setTextColor(Qt::black);
+    m_log->append(QString("Resuming the interrupted run of '%1', %2 files had been transcoded.").arg(m_root).arg(resume.finished));
+  }
+
+  if(resume.removed > 0)
+  {
+    m_log->setTextColor(Qt::black);
+    m_log->append(QString("Removed %1 partial output files of the interrupted run.").arg(resume.removed));
+  }
 
   auto boxLayout = new QVBoxLayout();
   m_workers->setLayout(boxLayout);
 
-  int initial_jobs = (m_music_files.size() != 0) ? m_music_files.size() : m_music_folders.size();
+  update_global_progress();
 
-  auto bars_num = std::min(m_max_workers, initial_jobs);
-  for(int i = 0; i < bars_num; ++i)
-  {
-    auto bar = new QProgressBar();
-    bar->setStyle(QStyleFactory::create("windowsvista"));
-    bar->setAlignment(Qt::AlignCenter);
-    bar->setMaximum(0);
-    bar->setMaximum(100);
-    bar->setValue(0);
-    bar->setEnabled(false);
+  // the files are transcoded as they are found, the scan runs while transcoding.
+  m_scanner = new DirectoryScanner(m_root, m_configuration, this);
 
-    m_progress_bars[bar] = nullptr;
+  connect(m_scanner, SIGNAL(files_found(const QList<QFileInfo> &)),
+          this,      SLOT(on_files_found(const QList<QFileInfo> &)));
 
-    boxLayout->addWidget(bar);
-  }
+  connect(m_scanner, SIGNAL(folders_found(const QList<QFileInfo> &)),
+          this,      SLOT(on_folders_found(const QList<QFileInfo> &)));
 
-  m_finished_transcoding = (files.size() == 0);
+  connect(m_scanner, SIGNAL(finished()),
+          this,      SLOT(on_scan_finished()));
 
-  create_threads();
+  m_scan_timer.start();
+  m_scanner->start();
 }
 
 //-----------------------------------------------------------------
 ProcessDialog::~ProcessDialog()
 {
   m_progress_bars.clear();
+
+  // the workers have finished or have been stopped.
+  PlaylistCache::save();
+  LibraryIndex::close();
+  RunJournal::close();
 }
 
 //-----------------------------------------------------------------
@@ -149,6 +183,22 @@ void ProcessDialog::log_information(const QString &message)
 //-----------------------------------------------------------------
 void ProcessDialog::stop()
 {
+  {
+    QMutexLocker lock(&m_mutex);
+    m_stopped = true;
+    m_music_files.clear();
+  }
+
+  if(m_scanner)
+  {
+    m_scanner->stop();
+  }
+
+  if(m_watcher)
+  {
+    m_watcher->stop();
+  }
+
   for(auto worker: m_progress_bars.values())
   {
     if(worker != nullptr)
@@ -198,59 +248,238 @@ void ProcessDialog::increment_global_progress()
 
   worker->deleteLater();
 
-  if((m_globalProgress->maximum() == m_globalProgress->value()) || cancelled)
+  if(!m_scanning && ((m_total_jobs == m_globalProgress->value()) || cancelled))
   {
-    disconnect(m_cancelButton, SIGNAL(clicked()),
-               this,           SLOT(stop()));
+    set_close_button();
+  }
 
-    connect(m_cancelButton,    SIGNAL(clicked()),
-            this,              SLOT(exit_dialog()));
+  if(!m_scanning && m_music_files.empty() && m_num_workers == 0)
+  {
+    finish_transcoding();
+  }
+
+  m_mutex.unlock();
 
-    m_cancelButton->setText("Close");
-    m_cancelButton->setToolTip(tr("Close the processing dialog."));
-    m_clipboard->setEnabled(true);
-    m_clipboard->setToolTip(tr("Copy log to clipboard."));
+  if(!cancelled)
+  {
+    create_threads();
   }
+}
 
-  if(m_music_files.empty() && m_num_workers == 0)
+//-----------------------------------------------------------------
+void ProcessDialog::on_files_found(const QList<QFileInfo> &files)
+{
   {
-    m_finished_transcoding = true;
+    QMutexLocker lock(&m_mutex);
 
-    const auto bars_num = std::min(m_max_workers, static_cast<int>(m_music_folders.size()));
-    while(m_progress_bars.size() < bars_num)
-    {
-      auto bar = new QProgressBar();
-      bar->setStyle(QStyleFactory::create("windowsvista"));
-      bar->setAlignment(Qt::AlignCenter);
-      bar->setMaximum(0);
-      bar->setMaximum(100);
-      bar->setValue(0);
-      bar->setEnabled(false);
+    if(m_stopped) return;
 
-      m_progress_bars[bar] = nullptr;
+    m_music_files << files;
+    m_total_jobs  += files.size();
 
-      m_workers->layout()->addWidget(bar);
+    // files found by the watcher after the transcoding had finished, the playlists wait for them.
+    if(!m_scanning)
+    {
+      m_finished_transcoding = false;
     }
+
+    add_progress_bars(m_num_workers + m_music_files.size());
+    update_global_progress();
   }
 
-  m_mutex.unlock();
+  create_threads();
+}
 
-  if(!cancelled)
+//-----------------------------------------------------------------
+void ProcessDialog::on_folders_found(const QList<QFileInfo> &folders)
+{
+  QMutexLocker lock(&m_mutex);
+
+  if(m_stopped) return;
+
+  m_music_folders << folders;
+  m_total_jobs    += folders.size();
+
+  update_global_progress();
+}
+
+//-----------------------------------------------------------------
+void ProcessDialog::on_scan_finished()
+{
+  {
+    QMutexLocker lock(&m_mutex);
+
+    m_scanning = false;
+
+    if(!m_stopped)
+    {
+      m_log->setTextColor(Qt::black);
+      m_log->append(QString("Found %1 files to transcode in %2 folders in %3 seconds.").arg(m_scanner->found_files())
+                                                                                     .arg(m_scanner->scanned_directories())
+                                                                                     .arg(m_scan_timer.elapsed() / 1000.0, 0, 'f', 2));
+
+      if(m_scanner->skipped_files() > 0)
+      {
+        m_log->append(QString("Skipped %1 files transcoded in previous runs.").arg(m_scanner->skipped_files()));
+      }
+
+      if(m_configuration.watchRootDirectory())
+      {
+        // only the directories that change are listed again, the tree isn't scanned.
+        m_watcher = new FolderWatcher(m_configuration, this);
+
+        connect(m_watcher, SIGNAL(files_found(const QList<QFileInfo> &)),
+                this,      SLOT(on_files_found(const QList<QFileInfo> &)));
+
+        connect(m_watcher, SIGNAL(folders_found(const QList<QFileInfo> &)),
+                this,      SLOT(on_folders_found(const QList<QFileInfo> &)));
+
+        m_watcher->watch(DirectoryIndex::directories());
+
+        m_log->append(QString("Watching %1 folders for new files.").arg(m_watcher->watched_directories()));
+      }
+    }
+
+    update_global_progress();
+
+    if(m_stopped || m_total_jobs == m_globalProgress->value())
+    {
+      set_close_button();
+    }
+
+    if(m_music_files.empty() && m_num_workers == 0)
+    {
+      finish_transcoding();
+    }
+  }
+
+  if(!m_stopped)
   {
     create_threads();
   }
 }
 
+//-----------------------------------------------------------------
+void ProcessDialog::update_global_progress()
+{
+  // an empty range shows a busy indicator until the first jobs are found.
+  m_globalProgress->setRange(0, m_total_jobs);
+  m_taskBarButton.setRange(0, m_total_jobs);
+
+  if(m_scanning)
+  {
+    m_globalProgress->setFormat(QString("Scanning: %1 files in %2 folders").arg(m_scanner ? m_scanner->found_files() : 0)
+                                                                            .arg(m_scanner ? m_scanner->scanned_directories() : 0));
+  }
+  else
+  {
+    m_globalProgress->setFormat("%p%");
+  }
+}
+
+//-----------------------------------------------------------------
+void ProcessDialog::add_progress_bars(const int jobs)
+{
+  const auto bars_num = std::min(m_max_workers, jobs);
+  while(m_progress_bars.size() < bars_num)
+  {
+    auto bar = new QProgressBar();
+    bar->setStyle(QStyleFactory::create("windowsvista"));
+    bar->setAlignment(Qt::AlignCenter);
+    bar->setMaximum(0);
+    bar->setMaximum(100);
+    bar->setValue(0);
+    bar->setEnabled(false);
+
+    m_progress_bars[bar] = nullptr;
+
+    m_workers->layout()->addWidget(bar);
+  }
+}
+
+//-----------------------------------------------------------------
+void ProcessDialog::set_close_button()
+{
+  disconnect(m_cancelButton, SIGNAL(clicked()),
+             this,           SLOT(stop()));
+
+  connect(m_cancelButton,    SIGNAL(clicked()),
+          this,              SLOT(exit_dialog()), Qt::UniqueConnection);
+
+  m_cancelButton->setText("Close");
+  m_cancelButton->setToolTip(tr("Close the processing dialog."));
+  m_clipboard->setEnabled(true);
+  m_clipboard->setToolTip(tr("Copy log to clipboard."));
+}
+
+//-----------------------------------------------------------------
+void ProcessDialog::finish_transcoding()
+{
+  if(!m_finished_transcoding && Worker::bytes_saved() > 0)
+  {
+    m_log->setTextColor(Qt::black);
+    m_log->append(QString("Adapting the bitrate to the sources saved about %1 MiB.").arg(Worker::bytes_saved() / (1024.0 * 1024.0), 0, 'f', 1));
+  }
+
+  if(!m_finished_transcoding)
+  {
+    const auto conversions = Worker::conversion_statistics();
+    for(auto it = conversions.cbegin(); it != conversions.cend(); ++it)
+    {
+      m_log->setTextColor(Qt::black);
+      m_log->append(QString("Decoded %1 MiB of '%2' audio, %3 MiB converted to the format of the encoders.").arg(it.value().decoded / (1024.0 * 1024.0), 0, 'f', 1)
+                    .arg(it.key()).arg(it.value().converted / (1024.0 * 1024.0), 0, 'f', 1));
+    }
+  }
+
+  if(!m_finished_transcoding)
+  {
+    const auto avoided = DirectoryContext::statistics();
+    if(avoided.probes + avoided.cue_sheets > 0)
+    {
+      m_log->setTextColor(Qt::black);
+      m_log->append(QString("Sharing the directory state avoided %1 file operations (%2 permission probes, %3 CUE sheet reads).").arg(3 * (avoided.probes + avoided.cue_sheets))
+                    .arg(avoided.probes).arg(avoided.cue_sheets));
+    }
+  }
+
+  if(!m_finished_transcoding)
+  {
+    const auto formatted = Utils::FormatProgram::statistics();
+    if(formatted.names > 0 && formatted.nanoseconds > 0)
+    {
+      m_log->setTextColor(Qt::black);
+      m_log->append(QString("Formatted %1 output names, %2 names per second.").arg(formatted.names)
+                    .arg(static_cast<long long>((formatted.names * 1000000000.0) / formatted.nanoseconds)));
+    }
+  }
+
+  // all the jobs have been done, the next run doesn't resume this one.
+  if(!m_finished_transcoding && !m_stopped)
+  {
+    RunJournal::complete();
+  }
+
+  m_finished_transcoding = true;
+
+  add_progress_bars(m_music_folders.size());
+}
+
 //-----------------------------------------------------------------
 void ProcessDialog::create_threads()
 {
   QMutexLocker lock(&m_mutex);
 
+  if(m_stopped) return;
+
   while(m_num_workers < m_max_workers && m_music_files.size() > 0)
   {
     create_transcoder();
   }
 
+  // playlists are generated after the transcoding, only the files compete for the threads.
+  Worker::set_pending_jobs(m_music_files.size());
+
   if(m_finished_transcoding)
   {
     while(m_num_workers < m_max_workers && m_music_folders.size() > 0)
@@ -270,27 +499,25 @@ void ProcessDialog::create_transcoder()
 
   Worker *worker = nullptr;
 
-  if(Utils::isModuleFile(fs_handle))
-  {
-    worker = new ModuleWorker(fs_handle, m_configuration);
-  }
-  else
+  // the contents decide the worker, a misnamed file would fail in the wrong one.
+  switch(FileClassifier::classify(fs_handle))
   {
-    if(Utils::isMP3File(fs_handle))
-    {
+    case FileClassifier::Kind::MODULE:
+      worker = new ModuleWorker(fs_handle, m_configuration);
+      break;
+    case FileClassifier::Kind::MP3:
       worker = new MP3Worker(fs_handle, m_configuration);
-    }
-    else
-    {
-      if(Utils::isAudioFile(fs_handle) || Utils::isVideoFile(fs_handle))
-      {
-        worker = new AudioWorker(fs_handle, m_configuration);
-      }
-      else
-      {
-        Q_ASSERT(false);
-      }
-    }
+      break;
+    case FileClassifier::Kind::PCM:
+      worker = new PCMWorker(fs_handle, m_configuration);
+      break;
+    case FileClassifier::Kind::AUDIO:
+    case FileClassifier::Kind::VIDEO:
+      worker = new AudioWorker(fs_handle, m_configuration);
+      break;
+    default:
+      Q_ASSERT(false);
+      break;
   }
 
   auto message = QString("%1").arg(fs_handle.absoluteFilePath().split('/').last());
@@ -29,6 +29,7 @@
 #include <QList>
 #include <QMap>
 #include <QMutex>
+#include <QElapsedTimer>
 
 // libav
 extern "C"
@@ -39,6 +40,8 @@ extern "C"
 class QProgressBar;
 class QFileInfo;
 class Worker;
+class DirectoryScanner;
+class FolderWatcher;
 
 // C++
 #include <memory>
@@ -53,14 +56,13 @@ class ProcessDialog
 {
     Q_OBJECT
   public:
-    /** \brief ProcessDialog class constructor.
-     * \param[in] files files to transcode.
-     * \param[in] folders to create playlists.
-     * \param[in] threadNum number of threads to use in the transcoding process.
+    /** \brief ProcessDialog class constructor. Scans the root directory and transcodes the files
+     *         as they are found.
+     * \param[in] root root directory.
+     * \param[in] configuration configuration struct reference.
      *
      */
-    explicit ProcessDialog(const QList<QFileInfo> &files,
-                           const QList<QFileInfo> &folders,
+    explicit ProcessDialog(const QString &root,
                            const Utils::TranscoderConfiguration &configuration,
                            QWidget *parent = nullptr,
                            Qt::WindowFlags flags = Qt::WindowFlags());
@@ -109,6 +111,25 @@ class ProcessDialog
      */
     void onClipboardPressed() const;
 
+    /** \brief Adds the files found by the scanner to the list of files to transcode and launches
+     *         the workers.
+     * \param[in] files files information.
+     *
+     */
+    void on_files_found(const QList<QFileInfo> &files);
+
+    /** \brief Adds the folders found by the scanner to the list of folders to create playlists.
+     * \param[in] folders folders information.
+     *
+     */
+    void on_folders_found(const QList<QFileInfo> &folders);
+
+    /** \brief Updates the dialog when the scan ends, and finishes the transcoding if there is nothing
+     *         left to transcode.
+     *
+     */
+    void on_scan_finished();
+
   private:
     /** \brief Creates and launches the workers' threads.
      *
@@ -132,6 +153,29 @@ class ProcessDialog
      */
     void create_playlistWorker();
 
+    /** \brief Updates the range and text of the global progress bar with the number of jobs found.
+     *
+     */
+    void update_global_progress();
+
+    /** \brief Adds progress bars until there is one for each given job, without exceeding the
+     *         maximum number of workers.
+     * \param[in] jobs number of jobs.
+     *
+     */
+    void add_progress_bars(const int jobs);
+
+    /** \brief Changes the cancel button to close the dialog.
+     *
+     */
+    void set_close_button();
+
+    /** \brief Logs the statistics of the transcoding and prepares the playlists generation.
+     *
+     */
+    void finish_transcoding();
+
+    const QString                         m_root;                 /** root directory.                            */
     QList<QFileInfo>                      m_music_files;          /** list of file informations.                 */
     QList<QFileInfo>                      m_music_folders;        /** list of folder informations.               */
     int                                   m_max_workers;          /** max number of simultaneous threads.        */
@@ -139,6 +183,12 @@ class ProcessDialog
     const Utils::TranscoderConfiguration &m_configuration;        /** application configuration struct.          */
     int                                   m_errorsCount;          /** number of errors that have ocurred.        */
     bool                                  m_finished_transcoding; /** true if process finished, false otherwise. */
+    DirectoryScanner                     *m_scanner;              /** scanner of the root directory.             */
+    FolderWatcher                        *m_watcher;              /** watcher of the root directory.             */
+    bool                                  m_scanning;             /** true while the scan is running.            */
+    bool                                  m_stopped;              /** true if the process has been cancelled.    */
+    int                                   m_total_jobs;           /** number of jobs found.                      */
+    QElapsedTimer                         m_scan_timer;           /** measures the duration of the scan.         */
     QMutex                                m_mutex;                /** protects internal data and writes to log.  */
     QMap<QProgressBar *, Worker *>        m_progress_bars;        /** maps worker<->progress bar.                */
     QTaskBarButton                        m_taskBarButton;        /** taskbar progress widget.                   */
@@ -0,0 +1,250 @@
+/*
+ File: RunJournal.cpp
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include "RunJournal.h"
+#include "LibraryIndex.h"
+
+// Qt
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+
+// C++
+#include <utility>
+#include <fileapi.h>
+#include <io.h>
+
+QMutex        RunJournal::s_mutex;
+QFile         RunJournal::s_file;
+QByteArray    RunJournal::s_pending;
+int           RunJournal::s_events = 0;
+QElapsedTimer RunJournal::s_timer;
+QSet<QString> RunJournal::s_finished;
+
+//-----------------------------------------------------------------
+RunJournal::Resume RunJournal::open(const QString &root, const Utils::TranscoderConfiguration &configuration)
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(s_file.isOpen())
+  {
+    sync();
+    s_file.close();
+  }
+
+  s_pending.clear();
+  s_events = 0;
+  s_finished.clear();
+
+  Resume resume{false, 0, 0};
+
+  // the run is identified by the root directory and the settings that affect the outputs.
+  const auto run = QDir::fromNativeSeparators(QDir(root).absolutePath()) + QString("\t") + QString::fromLatin1(LibraryIndex::settings_hash(configuration).toHex());
+
+  QFile previous(file_name());
+  if(previous.open(QIODevice::ReadOnly))
+  {
+    bool same_run  = false;
+    bool completed = false;
+    QSet<QString> finished;
+    QStringList   outputs;
+
+    while(!previous.atEnd())
+    {
+      const auto line = previous.readLine();
+
+      // an event without the end of line was being written when the run was interrupted.
+      if(!line.endsWith('\n')) break;
+
+      const auto event     = QString::fromUtf8(line.chopped(1));
+      const auto separator = event.indexOf('\t');
+      const auto type      = event.left(separator);
+      const auto value     = event.mid(separator + 1);
+
+      if(type == "RUN")         same_run = (value == run);
+      else if(type == "DONE")   finished.insert(value);
+      else if(type == "FAIL")   finished.remove(value);
+      else if(type == "OUTPUT") outputs << value;
+      else if(type == "END")    completed = true;
+    }
+
+    previous.close();
+
+    // the temporary outputs left are partial, the finished ones have been renamed.
+    for(const auto &output: std::as_const(outputs))
+    {
+      if(QFile::exists(output) && QFile::remove(output))
+      {
+        ++resume.removed;
+      }
+    }
+
+    if(same_run && !completed)
+    {
+      s_finished      = finished;
+      resume.resumed  = true;
+      resume.finished = finished.size();
+    }
+  }
+
+  QDir().mkpath(QFileInfo(file_name()).absolutePath());
+
+  // the new journal starts with the jobs finished in the resumed run, so it can be resumed again.
+  {
+    QByteArray contents = QByteArray("RUN\t") + run.toUtf8() + '\n';
+    for(const auto &source: std::as_const(s_finished))
+    {
+      contents += QByteArray("DONE\t") + source.toUtf8() + '\n';
+    }
+
+    QSaveFile file(file_name());
+    if(!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit())
+    {
+      return resume;
+    }
+  }
+
+  s_file.setFileName(file_name());
+  if(s_file.open(QIODevice::WriteOnly|QIODevice::Append))
+  {
+    s_timer.start();
+  }
+
+  return resume;
+}
+
+//-----------------------------------------------------------------
+void RunJournal::complete()
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(s_file.isOpen())
+  {
+    append("END", QString(), true);
+  }
+}
+
+//-----------------------------------------------------------------
+void RunJournal::close()
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(s_file.isOpen())
+  {
+    sync();
+    s_file.close();
+  }
+
+  s_finished.clear();
+}
+
+//-----------------------------------------------------------------
+bool RunJournal::finished(const QString &file_name)
+{
+  QMutexLocker lock(&s_mutex);
+
+  return s_finished.contains(file_name);
+}
+
+//-----------------------------------------------------------------
+void RunJournal::job_started(const QString &file_name)
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(s_file.isOpen())
+  {
+    append("START", file_name, false);
+  }
+}
+
+//-----------------------------------------------------------------
+void RunJournal::job_finished(const QString &file_name)
+{
+  QMutexLocker lock(&s_mutex);
+
+  // a finished job lost in an interrupted batch is only done again.
+  if(s_file.isOpen())
+  {
+    append("DONE", file_name, false);
+  }
+}
+
+//-----------------------------------------------------------------
+void RunJournal::job_failed(const QString &file_name)
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(s_file.isOpen())
+  {
+    append("FAIL", file_name, false);
+  }
+}
+
+//-----------------------------------------------------------------
+void RunJournal::output_created(const QString &file_name)
+{
+  QMutexLocker lock(&s_mutex);
+
+  if(s_file.isOpen())
+  {
+    append("OUTPUT", file_name, true);
+  }
+}
+
+//-----------------------------------------------------------------
+void RunJournal::append(const char *type, const QString &value, const bool sync_now)
+{
+  s_pending += type;
+  s_pending += '\t';
+  s_pending += value.toUtf8();
+  s_pending += '\n';
+  ++s_events;
+
+  if(sync_now || s_events >= SYNC_EVENTS || s_timer.elapsed() >= SYNC_INTERVAL)
+  {
+    sync();
+  }
+}
+
+//-----------------------------------------------------------------
+void RunJournal::sync()
+{
+  if(!s_pending.isEmpty())
+  {
+    // a single write, an interrupted one leaves only the last event incomplete.
+    s_file.write(s_pending);
+    s_file.flush();
+    FlushFileBuffers((HANDLE)_get_osfhandle(s_file.handle()));
+
+    s_pending.clear();
+    s_events = 0;
+  }
+
+  s_timer.restart();
+}
+
+//-----------------------------------------------------------------
+QString RunJournal::file_name()
+{
+  return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QString("/run.journal");
+}
@@ -0,0 +1,135 @@
+/*
+ File: RunJournal.h
+ Created on: 18/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUN_JOURNAL_H_
+#define RUN_JOURNAL_H_
+
+// Project
+#include "Utils.h"
+
+// Qt
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+/** \class RunJournal
+ * \brief Append-only record of the jobs started, finished and failed in the current run and of the
+ *        temporary files of the outputs being written. The events are written to disk in batches. If
+ *        a run is interrupted the next run of the same directory with the same settings removes the
+ *        partial outputs and skips the jobs that had finished.
+ *
+ */
+class RunJournal
+{
+  public:
+    /** \struct Resume
+     * \brief Result of resuming an interrupted run.
+     *
+     */
+    struct Resume
+    {
+      bool resumed;  /** true if an interrupted run has been resumed. */
+      int  finished; /** number of jobs finished in the previous run. */
+      int  removed;  /** number of partial outputs removed.           */
+    };
+
+    /** \brief Opens the journal for a run, resuming the previous one if it was interrupted and has
+     *         the same root directory and settings, and starting a new journal otherwise.
+     * \param[in] root root directory of the run.
+     * \param[in] configuration configuration of the run.
+     *
+     */
+    static Resume open(const QString &root, const Utils::TranscoderConfiguration &configuration);
+
+    /** \brief Marks the run as finished, the next run won't resume it.
+     *
+     */
+    static void complete();
+
+    /** \brief Writes the pending events and closes the journal.
+     *
+     */
+    static void close();
+
+    /** \brief Returns true if the job of the source finished in the resumed run.
+     * \param[in] file_name absolute file name of the source.
+     *
+     */
+    static bool finished(const QString &file_name);
+
+    /** \brief Records the start of the job of a source.
+     * \param[in] file_name absolute file name of the source.
+     *
+     */
+    static void job_started(const QString &file_name);
+
+    /** \brief Records the successful end of the job of a source.
+     * \param[in] file_name absolute file name of the source.
+     *
+     */
+    static void job_finished(const QString &file_name);
+
+    /** \brief Records the failure or cancellation of the job of a source.
+     * \param[in] file_name absolute file name of the source.
+     *
+     */
+    static void job_failed(const QString &file_name);
+
+    /** \brief Records a temporary output file before it's created. Written to disk immediately, so
+     *         an interrupted run never leaves an output that isn't in the journal.
+     * \param[in] file_name absolute file name of the temporary output.
+     *
+     */
+    static void output_created(const QString &file_name);
+
+  private:
+    static const int SYNC_EVENTS   = 64;   /** maximum number of events pending to be written.     */
+    static const int SYNC_INTERVAL = 2000; /** maximum milliseconds the events are kept in memory. */
+
+    /** \brief Adds an event to the pending ones and writes them if the batch is full or old enough.
+     *         The mutex must be locked.
+     * \param[in] type event type.
+     * \param[in] value event value.
+     * \param[in] sync_now true to write the events immediately.
+     *
+     */
+    static void append(const char *type, const QString &value, const bool sync_now);
+
+    /** \brief Writes the pending events and flushes them to the disk. The mutex must be locked.
+     *
+     */
+    static void sync();
+
+    /** \brief Returns the absolute file name of the journal.
+     *
+     */
+    static QString file_name();
+
+    static QMutex        s_mutex;    /** protects the journal.                           */
+    static QFile         s_file;     /** journal file.                                   */
+    static QByteArray    s_pending;  /** events pending to be written.                   */
+    static int           s_events;   /** number of events pending to be written.         */
+    static QElapsedTimer s_timer;    /** time since the last write to disk.              */
+    static QSet<QString> s_finished; /** sources whose jobs finished in the resumed run. */
+};
+
+#endif // RUN_JOURNAL_H_
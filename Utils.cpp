@@ -19,6 +19,7 @@
 
 // Project
 #include "Utils.h"
+#include "FileClassifier.h"
 
 // Qt
 #include <QSettings>
@@ -26,21 +27,31 @@
 #include <QTemporaryFile>
 #include <QRegularExpression>
 #include <QCoreApplication>
+#include <QElapsedTimer>
 
 // C++
+#include <algorithm>
 #include <thread>
 #include <fileapi.h>
 #include <locale>
 #include <codecvt>
+#include <vector>
 
 const QStringList Utils::MODULE_FILE_EXTENSIONS  = {"*.669", "*.amf", "*.apun", "*.dsm", "*.far", "*.gdm", "*.it", "*.imf", "*.mod", "*.med", "*.mtm", "*.okt", "*.s3m", "*.stm", "*.stx", "*.ult", "*.uni", "*.xt", "*.xm"};
-const QStringList Utils::WAVE_FILE_EXTENSIONS    = {"*.flac", "*.ogg", "*.ape", "*.wav", "*.wma", "*.m4a", "*.voc", "*.wv", "*.mp3", "*.aiff"};
+const QStringList Utils::WAVE_FILE_EXTENSIONS    = {"*.flac", "*.ogg", "*.ape", "*.wav", "*.wma", "*.m4a", "*.voc", "*.wv", "*.mp3", "*.aiff", "*.aif", "*.aifc"};
 const QStringList Utils::MOVIE_FILE_EXTENSIONS   = {"*.mp4", "*.avi", "*.ogv", "*.webm", "*.mkv" };
 const QString     Utils::TEMPORAL_FILE_EXTENSION = QString(".MusicTranscoderTemporal");
 
 const QStringList fromStrings{" No.", "[", "]", "}", "{", ".", "_", ":", "~", "|", "/", ";", "\\", "pt ", "#", "arr ", "cond ", "comp ", "feat ", "alt ", "tk ", "seq", "*"};
 const QStringList toStrings{" Nº", "(", ")", ")", "(", " ", " ", " -", "-", "-", " - ", "-", "''", "part ", "Nº", "arranged ", "conductor ", "composer ", "featuring ", "alternate ", "take ", "sequence ", "_"  };
 
+// number prefixes of the names: "01 ..." and "1-01 ...".
+const QRegularExpression NUMBER("\\d+");
+const QRegularExpression DISC_AND_NUMBER("\\d+-\\d+");
+
+std::atomic<long long> Utils::FormatProgram::s_names{0};
+std::atomic<long long> Utils::FormatProgram::s_nanoseconds{0};
+
 const QString Utils::TranscoderConfiguration::ROOT_DIRECTORY                     = QObject::tr("Root directory");
 const QString Utils::TranscoderConfiguration::NUMBER_OF_THREADS                  = QObject::tr("Number of threads");
 const QString Utils::TranscoderConfiguration::TRANSCODE_AUDIO                    = QObject::tr("Transcode audio");
@@ -48,6 +59,10 @@ const QString Utils::TranscoderConfiguration::TRANSCODE_VIDEO
 const QString Utils::TranscoderConfiguration::TRANSCODE_MODULE                   = QObject::tr("Transcode Module files");
 const QString Utils::TranscoderConfiguration::STRIP_MP3                          = QObject::tr("Strip MP3 metadata");
 const QString Utils::TranscoderConfiguration::USE_CUE_SHEET                      = QObject::tr("Use CUE sheet");
+const QString Utils::TranscoderConfiguration::CUE_PREGAP_POLICY                  = QObject::tr("CUE sheet pregaps");
+const QString Utils::TranscoderConfiguration::VERIFY_CUE_SPLIT                   = QObject::tr("Verify CUE sheet split");
+const QString Utils::TranscoderConfiguration::SKIP_UNCHANGED_FILES               = QObject::tr("Skip unchanged files");
+const QString Utils::TranscoderConfiguration::WATCH_ROOT_DIRECTORY               = QObject::tr("Watch root directory");
 const QString Utils::TranscoderConfiguration::RENAME_INPUT_ON_SUCCESS            = QObject::tr("Rename input files on successfull transcoding");
 const QString Utils::TranscoderConfiguration::RENAMED_INPUT_EXTENSION            = QObject::tr("Renamed input files extension");
 const QString Utils::TranscoderConfiguration::USE_METADATA_TO_RENAME             = QObject::tr("Use metadata to rename output");
@@ -56,7 +71,13 @@ const QString Utils::TranscoderConfiguration::EXTRACT_COVER_PICTURE
 const QString Utils::TranscoderConfiguration::COVER_PICTURE_NAME                 = QObject::tr("Cover picture output filename");
 const QString Utils::TranscoderConfiguration::BITRATE                            = QObject::tr("Output bitrate");
 const QString Utils::TranscoderConfiguration::QUALITY                            = QObject::tr("Output quality");
+const QString Utils::TranscoderConfiguration::ENCODING_MODE                      = QObject::tr("Output encoding mode");
+const QString Utils::TranscoderConfiguration::VBR_QUALITY                        = QObject::tr("Output VBR quality");
+const QString Utils::TranscoderConfiguration::ADAPT_BITRATE                      = QObject::tr("Adapt output bitrate to source");
+const QString Utils::TranscoderConfiguration::MINIMUM_BITRATE                    = QObject::tr("Minimum output bitrate");
+const QString Utils::TranscoderConfiguration::ADDITIONAL_PROFILES                = QObject::tr("Additional output profiles");
 const QString Utils::TranscoderConfiguration::CREATE_M3U_FILES                   = QObject::tr("Create M3U playlists in input directories");
+const QString Utils::TranscoderConfiguration::WRITE_OUTPUT_TAGS                  = QObject::tr("Write tags to output files");
 const QString Utils::TranscoderConfiguration::REFORMAT_APPLY                     = QObject::tr("Reformat output filename");
 const QString Utils::TranscoderConfiguration::REFORMAT_CHARS_TO_DELETE           = QObject::tr("Characters to delete");
 const QString Utils::TranscoderConfiguration::REFORMAT_CHARS_TO_REPLACE_FROM     = QObject::tr("List of characters to replace from");
@@ -72,33 +93,33 @@ const QString INI_FILENAME{"MusicTranscoder.ini"};
 //-----------------------------------------------------------------
 bool Utils::isAudioFile(const QFileInfo &file)
 {
-  auto extension = file.absoluteFilePath().split('.').last().toLower();
+  const auto kind = FileClassifier::extension_kind(file);
 
-  return WAVE_FILE_EXTENSIONS.contains("*." + extension);
+  return kind == FileClassifier::Kind::AUDIO || kind == FileClassifier::Kind::MP3 || kind == FileClassifier::Kind::PCM;
 }
 
 //-----------------------------------------------------------------
 bool Utils::isVideoFile(const QFileInfo &file)
 {
-  auto extension = file.absoluteFilePath().split('.').last().toLower();
-
-  return MOVIE_FILE_EXTENSIONS.contains("*." + extension);
+  return FileClassifier::extension_kind(file) == FileClassifier::Kind::VIDEO;
 }
 
 //-----------------------------------------------------------------
 bool Utils::isModuleFile(const QFileInfo &file)
 {
-  auto extension = file.absoluteFilePath().split('.').last().toLower();
-
-  return MODULE_FILE_EXTENSIONS.contains("*." + extension);
+  return FileClassifier::extension_kind(file) == FileClassifier::Kind::MODULE;
 }
 
 //-----------------------------------------------------------------
 bool Utils::isMP3File(const QFileInfo &file)
 {
-  auto extension = file.absoluteFilePath().split('.').last().toLower();
+  return FileClassifier::extension_kind(file) == FileClassifier::Kind::MP3;
+}
 
-  return extension.compare(QString("mp3")) == 0;
+//-----------------------------------------------------------------
+bool Utils::isPCMFile(const QFileInfo &file)
+{
+  return FileClassifier::extension_kind(file) == FileClassifier::Kind::PCM;
 }
 
 //-----------------------------------------------------------------
@@ -123,8 +144,6 @@ QList<QFileInfo> Utils::findFiles(const QDir initialDir,
 
     if(!condition(info)) continue;
 
-    auto extension = info.absoluteFilePath().split('.').last().toLower();
-
     if (isMP3File(info))
     {
       mp3FilesFound << info;
@@ -143,83 +162,145 @@ QString Utils::formatString(const QString filename,
                             const Utils::FormatConfiguration &conf,
                             bool add_mp3_extension)
 {
-  // works for filenames and plain strings
-  QString formattedName = filename;
-  
-  auto fileInfo = QFileInfo(filename);
-  if(fileInfo.exists())
+  return FormatProgram(conf).apply(filename, QFileInfo::exists(filename), add_mp3_extension);
+}
+
+//-----------------------------------------------------------------
+Utils::FormatProgram::FormatProgram(const FormatConfiguration &configuration)
+: m_configuration{configuration}
+{
+  for(const auto &c: m_configuration.chars_to_delete)
   {
-    formattedName = fileInfo.absoluteFilePath().split('/').last();
+    m_deleted.insert(c.toCaseFolded().unicode());
+  }
+
+  // consecutive single character replacements are applied in one pass if none of them produces the
+  // character of a later one, otherwise the results would differ from replacing them one by one.
+  bool open_group = false;
+  for(const auto &pair: m_configuration.chars_to_replace)
+  {
+    if(pair.first.size() != 1)
+    {
+      m_replacements << Replacement{QHash<char16_t, QString>(), pair.first, pair.second};
+      open_group = false;
+      continue;
+    }
 
-    auto extension = formattedName.split('.').last();
-    auto extension_id = QString("*.") + extension;
-    bool identified = WAVE_FILE_EXTENSIONS.contains(extension_id)   ||
-                      MODULE_FILE_EXTENSIONS.contains(extension_id) ||
-                      MOVIE_FILE_EXTENSIONS.contains(extension_id);
+    const auto character = pair.first.at(0).toCaseFolded().unicode();
 
-    if (identified)
+    if(open_group)
     {
-      formattedName.remove(formattedName.lastIndexOf('.'), extension.length() + 1);
+      const auto &characters = m_replacements.last().characters;
+      const auto produced = std::any_of(characters.cbegin(), characters.cend(), [&pair](const QString &to) { return to.contains(pair.first, Qt::CaseInsensitive); });
+
+      if(!produced)
+      {
+        // a repeated character has already been replaced by the previous one.
+        if(!characters.contains(character)) m_replacements.last().characters.insert(character, pair.second);
+        continue;
+      }
     }
+
+    QHash<char16_t, QString> characters;
+    characters.insert(character, pair.second);
+    m_replacements << Replacement{characters, QString(), QString()};
+    open_group = true;
   }
+}
 
-  if(conf.character_simplification)
+//-----------------------------------------------------------------
+QString Utils::FormatProgram::apply(const QString &name, bool is_file, bool add_mp3_extension) const
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  // works for filenames and plain strings
+  QString formattedName = name;
+
+  if(is_file)
   {
-    QString simplified;
+    const QFileInfo fileInfo(name);
+    formattedName = fileInfo.absoluteFilePath().split('/').last();
 
-    auto simplifyCharacter = [&simplified](QChar &c)
+    // only lower case extensions are removed, the outputs of previous runs keep their names.
+    const auto extension = fileInfo.suffix();
+    if (extension == extension.toLower() && FileClassifier::extension_kind(fileInfo) != FileClassifier::Kind::UNKNOWN)
     {
-      if(c.isLetter())
-      {
-        const auto decomposition = c.decomposition();
-        if(decomposition.length() > 1)
-        {
-          simplified.append(decomposition.at(0));
-          return;
-        }
-      }
-      simplified.append(c);
-    };
-    std::for_each(formattedName.begin(), formattedName.end(), simplifyCharacter);
+      formattedName.chop(extension.length() + 1);
+    }
+  }
 
-    if(!simplified.isEmpty()) formattedName = simplified;
+  if(m_configuration.character_simplification)
+  {
+    const auto table = transliteration();
+
+    for(auto &c: formattedName)
+    {
+      c = QChar(table[c.unicode()]);
+    }
   }
 
-  // check for unwanted unicode chars
-  while(formattedName.toLatin1().contains('?'))
+  // check for unwanted unicode chars, the ones that can't be represented in latin1.
+  QString checkedName;
+  checkedName.reserve(formattedName.size());
+  for(const auto &c: formattedName)
   {
-    auto index = formattedName.toLatin1().indexOf('?');
+    if(c.unicode() <= 0xFF && c != QChar('?'))
+    {
+      checkedName.append(c);
+      continue;
+    }
 
-    switch(formattedName.at(index).category())
+    switch(c.category())
     {
       case QChar::Punctuation_Open:
       case QChar::Punctuation_Close:
       case QChar::Punctuation_InitialQuote:
       case QChar::Punctuation_FinalQuote:
-        formattedName = formattedName.replace(formattedName.at(index), QString("''"));
+        checkedName.append(QString("''"));
         break;
       case QChar::Punctuation_Dash:
-        formattedName = formattedName.replace(formattedName.at(index), '-');
+        checkedName.append(QChar('-'));
         break;
       default:
-        formattedName = formattedName.replace(formattedName.at(index), QChar::Space);
+        checkedName.append(QChar::Space);
         break;
     }
   }
+  formattedName = checkedName;
 
-  if (conf.apply)
+  if (m_configuration.apply)
   {
     // delete specified chars
-    for (int i = 0; i < conf.chars_to_delete.length(); ++i)
+    if(!m_deleted.isEmpty())
     {
-      formattedName.remove(conf.chars_to_delete[i], Qt::CaseInsensitive);
+      formattedName.removeIf([this](const QChar &c) { return m_deleted.contains(c.toCaseFolded().unicode()); });
     }
 
     // replace specified strings
-    for (int i = 0; i < conf.chars_to_replace.size(); ++i)
+    for(const auto &replacement: m_replacements)
     {
-      const auto charPair = conf.chars_to_replace[i];
-      formattedName.replace(charPair.first, charPair.second, Qt::CaseInsensitive);
+      if(replacement.characters.isEmpty())
+      {
+        formattedName.replace(replacement.from, replacement.to, Qt::CaseInsensitive);
+        continue;
+      }
+
+      QString replaced;
+      replaced.reserve(formattedName.size());
+      for(const auto &c: formattedName)
+      {
+        const auto it = replacement.characters.constFind(c.toCaseFolded().unicode());
+        if(it != replacement.characters.constEnd())
+        {
+          replaced.append(it.value());
+        }
+        else
+        {
+          replaced.append(c);
+        }
+      }
+      formattedName = replaced;
     }
 
     // remove consecutive spaces
@@ -231,12 +312,10 @@ QString Utils::formatString(const QString filename,
 
     // adjust the number prefix and insert the default separator.
     // Format 1: 01 ...
-    QRegularExpression re1("\\d+");
-    auto re1_match = re1.match(parts[index]);
+    auto re1_match = NUMBER.match(parts.isEmpty() ? QString() : parts[index]);
 
     // Format 2: 1-01 ...
-    QRegularExpression re2("\\d+-\\d+");
-    auto re2_match = re2.match(parts[index]);
+    auto re2_match = DISC_AND_NUMBER.match(parts.isEmpty() ? QString() : parts[index]);
 
     // only check number format if it exists, only for mp3 files.
     if (add_mp3_extension && (re1_match.hasMatch() || re2_match.hasMatch()))
@@ -253,24 +332,24 @@ QString Utils::formatString(const QString filename,
         number_string = splits.last();
       }
 
-      while (conf.number_of_digits > number_string.length())
+      while (m_configuration.number_of_digits > number_string.length())
       {
         number_string = "0" + number_string;
       }
 
       if (index != parts.size() - 1)
       {
-        if(parts[index + 1] != QString(conf.number_and_name_separator))
+        if(parts[index + 1] != QString(m_configuration.number_and_name_separator))
         {
-          number_string += QString(' ' + conf.number_and_name_separator + ' ');
+          number_string += QString(' ' + m_configuration.number_and_name_separator + ' ');
         }
         else
         {
-          parts[index + 1] = QString(' ' + conf.number_and_name_separator);
+          parts[index + 1] = QString(' ' + m_configuration.number_and_name_separator);
         }
       }
 
-      if(!number_disc_id.isEmpty() && conf.prefix_disk_num)
+      if(!number_disc_id.isEmpty() && m_configuration.prefix_disk_num)
       {
         number_string = number_disc_id + QString("-") + number_string;
       }
@@ -279,7 +358,7 @@ QString Utils::formatString(const QString filename,
     }
 
     // capitalize the first letter of every word
-    if (conf.to_title_case)
+    if (m_configuration.to_title_case)
     {
       int i = index;
       while (i < parts.size())
@@ -405,9 +484,57 @@ QString Utils::formatString(const QString filename,
     formattedName = formattedName.replace("''", "'");
   }
  
+  ++s_names;
+  s_nanoseconds += timer.nsecsElapsed();
+
   return formattedName;
 }
 
+
+//-----------------------------------------------------------------
+Utils::FormatProgram::Statistics Utils::FormatProgram::statistics()
+{
+  Statistics statistics;
+  statistics.names       = s_names;
+  statistics.nanoseconds = s_nanoseconds;
+
+  return statistics;
+}
+
+//-----------------------------------------------------------------
+void Utils::FormatProgram::reset_statistics()
+{
+  s_names       = 0;
+  s_nanoseconds = 0;
+}
+
+//-----------------------------------------------------------------
+const char16_t *Utils::FormatProgram::transliteration()
+{
+  // built the first time a name is simplified, every UTF-16 unit maps to itself or to the first
+  // character of its decomposition if it's a letter.
+  static const std::vector<char16_t> table = []()
+  {
+    std::vector<char16_t> values(0x10000);
+
+    for(std::size_t i = 0; i < values.size(); ++i)
+    {
+      const QChar c(static_cast<char16_t>(i));
+      values[i] = c.unicode();
+
+      if(c.isLetter())
+      {
+        const auto decomposition = c.decomposition();
+        if(decomposition.length() > 1) values[i] = decomposition.at(0).unicode();
+      }
+    }
+
+    return values;
+  }();
+
+  return table.data();
+}
+
 //-----------------------------------------------------------------
 bool Utils::isRomanNumeral(const QString string_part)
 {
@@ -422,6 +549,127 @@ bool Utils::isRomanNumeral(const QString string_part)
   return true;
 }
 
+//-----------------------------------------------------------------
+QString Utils::OutputProfile::name() const
+{
+  switch(codec)
+  {
+    case Codec::AAC:    return QString("AAC %1 kbps").arg(bitrate);
+    case Codec::OPUS:   return QString("Opus %1 kbps").arg(bitrate);
+    case Codec::VORBIS: return QString("Vorbis %1 kbps").arg(bitrate);
+    case Codec::MP3:
+    default:
+      break;
+  }
+
+  switch(mode)
+  {
+    case EncodingMode::VBR: return QString("VBR V%1").arg(vbr_quality);
+    case EncodingMode::ABR: return QString("ABR %1 kbps").arg(bitrate);
+    case EncodingMode::CBR:
+    default:
+      break;
+  }
+
+  return QString("CBR %1 kbps").arg(bitrate);
+}
+
+//-----------------------------------------------------------------
+QList<Utils::OutputProfile> Utils::outputProfilesFromString(const QString &text)
+{
+  static const QList<int> BITRATES = { 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+
+  QList<OutputProfile> profiles;
+  QSet<QString> names;
+
+  for(auto value: text.split(',', Qt::SkipEmptyParts))
+  {
+    value = value.trimmed().toUpper();
+    if(value.isEmpty()) continue;
+
+    OutputProfile profile;
+    bool valid = false;
+
+    const QList<QPair<QString, Codec>> CODECS = { { "AAC", Codec::AAC }, { "OPUS", Codec::OPUS }, { "VORBIS", Codec::VORBIS } };
+    const auto codec = std::find_if(CODECS.cbegin(), CODECS.cend(), [&value](const QPair<QString, Codec> &pair) { return value.startsWith(pair.first); });
+
+    if(codec != CODECS.cend())
+    {
+      profile.codec   = codec->second;
+      profile.bitrate = value.mid(codec->first.length()).toInt(&valid);
+      valid &= (profile.bitrate >= 16 && profile.bitrate <= 320);
+    }
+    else if(value.startsWith('V'))
+    {
+      profile.mode        = EncodingMode::VBR;
+      profile.vbr_quality = value.mid(1).toInt(&valid);
+      valid &= (profile.vbr_quality >= 0 && profile.vbr_quality <= 9);
+    }
+    else if(value.startsWith('A'))
+    {
+      profile.mode    = EncodingMode::ABR;
+      profile.bitrate = value.mid(1).toInt(&valid);
+      valid &= (profile.bitrate >= 8 && profile.bitrate <= 320);
+    }
+    else
+    {
+      profile.mode    = EncodingMode::CBR;
+      profile.bitrate = value.toInt(&valid);
+      valid &= BITRATES.contains(profile.bitrate);
+    }
+
+    // the outputs are written to a directory named after the profile, a repeated one would write the same files.
+    if(valid && !names.contains(profile.name()))
+    {
+      names.insert(profile.name());
+      profiles << profile;
+    }
+  }
+
+  return profiles;
+}
+
+//-----------------------------------------------------------------
+QString Utils::outputProfilesToString(const QList<OutputProfile> &profiles)
+{
+  QStringList values;
+
+  for(const auto &profile: profiles)
+  {
+    switch(profile.codec)
+    {
+      case Codec::AAC:
+        values << QString("AAC%1").arg(profile.bitrate);
+        continue;
+      case Codec::OPUS:
+        values << QString("OPUS%1").arg(profile.bitrate);
+        continue;
+      case Codec::VORBIS:
+        values << QString("VORBIS%1").arg(profile.bitrate);
+        continue;
+      case Codec::MP3:
+      default:
+        break;
+    }
+
+    switch(profile.mode)
+    {
+      case EncodingMode::VBR:
+        values << QString("V%1").arg(profile.vbr_quality);
+        break;
+      case EncodingMode::ABR:
+        values << QString("A%1").arg(profile.bitrate);
+        break;
+      case EncodingMode::CBR:
+      default:
+        values << QString::number(profile.bitrate);
+        break;
+    }
+  }
+
+  return values.join(", ");
+}
+
 //-----------------------------------------------------------------
 Utils::TranscoderConfiguration::TranscoderConfiguration()
 : m_number_of_threads             {0}
@@ -430,13 +678,23 @@ Utils::TranscoderConfiguration::TranscoderConfiguration()
 , m_transcode_module              {true}
 , m_strip_tags_from_MP3           {true}
 , m_use_CUE_to_split              {true}
+, m_cue_pregap_policy             {PregapPolicy::APPEND}
+, m_verify_CUE_split              {false}
+, m_skip_unchanged_files          {true}
+, m_watch_root_directory          {false}
 , m_rename_input_on_success       {true}
 , m_use_metadata_to_rename_output {true}
 , m_delete_output_on_cancellation {true}
 , m_extract_metadata_cover_picture{true}
 , m_bitrate                       {320}
 , m_quality                       {0}
+, m_encoding_mode                 {EncodingMode::CBR}
+, m_vbr_quality                   {2}
+, m_adapt_bitrate_to_source       {false}
+, m_minimum_bitrate               {128}
 , m_create_M3U_files              {true}
+, m_write_output_tags             {false}
+, m_format_program              {std::make_shared<const FormatProgram>(m_format_configuration)}
 {
 }
 
@@ -452,6 +710,10 @@ void Utils::TranscoderConfiguration::load()
   m_transcode_module                               = settings->value(TRANSCODE_MODULE, true).toBool();
   m_strip_tags_from_MP3                            = settings->value(STRIP_MP3, true).toBool();
   m_use_CUE_to_split                               = settings->value(USE_CUE_SHEET, true).toBool();
+  m_cue_pregap_policy                              = static_cast<PregapPolicy>(std::clamp(settings->value(CUE_PREGAP_POLICY, 0).toInt(), 0, 2));
+  m_verify_CUE_split                               = settings->value(VERIFY_CUE_SPLIT, false).toBool();
+  m_skip_unchanged_files                           = settings->value(SKIP_UNCHANGED_FILES, true).toBool();
+  m_watch_root_directory                           = settings->value(WATCH_ROOT_DIRECTORY, false).toBool();
   m_rename_input_on_success                        = settings->value(RENAME_INPUT_ON_SUCCESS, true).toBool();
   m_renamed_input_extension                        = settings->value(RENAMED_INPUT_EXTENSION, QObject::tr("done")).toString();
   m_use_metadata_to_rename_output                  = settings->value(USE_METADATA_TO_RENAME, true).toBool();
@@ -460,7 +722,13 @@ void Utils::TranscoderConfiguration::load()
   m_cover_picture_name                             = settings->value(COVER_PICTURE_NAME, QObject::tr("Frontal")).toString();
   m_bitrate                                        = settings->value(BITRATE, 320).toInt();
   m_quality                                        = settings->value(QUALITY, 0).toInt();
+  m_encoding_mode                                  = static_cast<EncodingMode>(std::clamp(settings->value(ENCODING_MODE, 0).toInt(), 0, 2));
+  m_vbr_quality                                    = std::clamp(settings->value(VBR_QUALITY, 2).toInt(), 0, 9);
+  m_adapt_bitrate_to_source                        = settings->value(ADAPT_BITRATE, false).toBool();
+  m_minimum_bitrate                                = settings->value(MINIMUM_BITRATE, 128).toInt();
+  m_additional_profiles                            = outputProfilesFromString(settings->value(ADDITIONAL_PROFILES, QString()).toString());
   m_create_M3U_files                               = settings->value(CREATE_M3U_FILES, true).toBool();
+  m_write_output_tags                              = settings->value(WRITE_OUTPUT_TAGS, false).toBool();
   m_format_configuration.apply                     = settings->value(REFORMAT_APPLY, true).toBool();
   m_format_configuration.chars_to_delete           = settings->value(REFORMAT_CHARS_TO_DELETE, QString()).toString();
   m_format_configuration.number_of_digits          = settings->value(REFORMAT_NUMBER_OF_DIGITS, 2).toInt();
@@ -484,6 +752,8 @@ void Utils::TranscoderConfiguration::load()
       m_format_configuration.chars_to_replace << pair;
     }
   }
+
+  m_format_program = std::make_shared<const FormatProgram>(m_format_configuration);
 }
 
 //-----------------------------------------------------------------
@@ -498,6 +768,10 @@ void Utils::TranscoderConfiguration::save() const
   settings->setValue(TRANSCODE_MODULE, m_transcode_module);
   settings->setValue(STRIP_MP3, m_strip_tags_from_MP3);
   settings->setValue(USE_CUE_SHEET, m_use_CUE_to_split);
+  settings->setValue(CUE_PREGAP_POLICY, static_cast<int>(m_cue_pregap_policy));
+  settings->setValue(VERIFY_CUE_SPLIT, m_verify_CUE_split);
+  settings->setValue(SKIP_UNCHANGED_FILES, m_skip_unchanged_files);
+  settings->setValue(WATCH_ROOT_DIRECTORY, m_watch_root_directory);
   settings->setValue(RENAME_INPUT_ON_SUCCESS, m_rename_input_on_success);
   settings->setValue(RENAMED_INPUT_EXTENSION, m_renamed_input_extension);
   settings->setValue(USE_METADATA_TO_RENAME, m_use_metadata_to_rename_output);
@@ -506,7 +780,13 @@ void Utils::TranscoderConfiguration::save() const
   settings->setValue(COVER_PICTURE_NAME, m_cover_picture_name);
   settings->setValue(BITRATE, m_bitrate);
   settings->setValue(QUALITY, m_quality);
+  settings->setValue(ENCODING_MODE, static_cast<int>(m_encoding_mode));
+  settings->setValue(VBR_QUALITY, m_vbr_quality);
+  settings->setValue(ADAPT_BITRATE, m_adapt_bitrate_to_source);
+  settings->setValue(MINIMUM_BITRATE, m_minimum_bitrate);
+  settings->setValue(ADDITIONAL_PROFILES, outputProfilesToString(m_additional_profiles));
   settings->setValue(CREATE_M3U_FILES, m_create_M3U_files);
+  settings->setValue(WRITE_OUTPUT_TAGS, m_write_output_tags);
   settings->setValue(REFORMAT_APPLY, m_format_configuration.apply);
   settings->setValue(REFORMAT_CHARS_TO_DELETE, m_format_configuration.chars_to_delete);
   settings->setValue(REFORMAT_NUMBER_OF_DIGITS, m_format_configuration.number_of_digits);
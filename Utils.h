@@ -29,8 +29,11 @@
 #include <QPair>
 #include <QMutex>
 #include <QLabel>
+#include <QHash>
+#include <QSet>
 
 // C++
+#include <atomic>
 #include <memory>
 
 class QSettings;
@@ -67,6 +70,12 @@ namespace Utils
    */
   bool isMP3File(const QFileInfo &file);
 
+  /** \brief Returns true if the file given as parameter has an uncompressed audio extension (wav, aiff, aif or aifc).
+   * \param[in] file file QFileInfo struct.
+   *
+   */
+  bool isPCMFile(const QFileInfo &file);
+
   /** \brief Returs true if the string has only spaces.
    *
    */
@@ -147,6 +156,75 @@ namespace Utils
                        const FormatConfiguration &conf,
                        bool add_mp3_extension = true);
 
+  /** \class FormatProgram
+   * \brief FormatConfiguration compiled once into the steps applied to the names. Gives the same
+   *        results as formatString() without checking the disk or building anything per name.
+   *
+   */
+  class FormatProgram
+  {
+    public:
+      /** \struct Statistics
+       * \brief Names formatted and time spent.
+       *
+       */
+      struct Statistics
+      {
+        long long names;       /** number of formatted names.      */
+        long long nanoseconds; /** time spent formatting the names. */
+
+        Statistics(): names{0}, nanoseconds{0} {};
+      };
+
+      /** \brief FormatProgram class constructor.
+       * \param[in] configuration configuration parameters.
+       *
+       */
+      explicit FormatProgram(const FormatConfiguration &configuration);
+
+      /** \brief Returns the transformed name.
+       * \param[in] name file name with absolute path or plain string.
+       * \param[in] is_file true if the name is an existing file, only its name without a known extension is used.
+       * \param[in] add_mp3_extension true to add the ".mp3" extension to the formatted string.
+       *
+       */
+      QString apply(const QString &name, bool is_file, bool add_mp3_extension = true) const;
+
+      /** \brief Returns the names formatted by all the programs since the last reset.
+       *
+       */
+      static Statistics statistics();
+
+      /** \brief Resets the statistics of the programs.
+       *
+       */
+      static void reset_statistics();
+
+    private:
+      /** \struct Replacement
+       * \brief Replacement step, a group of single characters replaced in one pass or a string.
+       *
+       */
+      struct Replacement
+      {
+        QHash<char16_t, QString> characters; /** case folded characters and their replacements, empty for strings. */
+        QString                  from;       /** string to replace.                                                 */
+        QString                  to;         /** replacement string.                                                */
+      };
+
+      /** \brief Returns the table of the character simplification, built the first time.
+       *
+       */
+      static const char16_t *transliteration();
+
+      const FormatConfiguration m_configuration; /** configuration parameters.            */
+      QSet<char16_t>            m_deleted;       /** case folded characters to delete.    */
+      QList<Replacement>        m_replacements;  /** replacement steps, in order.         */
+
+      static std::atomic<long long> s_names;       /** number of formatted names.       */
+      static std::atomic<long long> s_nanoseconds; /** time spent formatting the names. */
+  };
+
   /** \brief Returns true if the string represents a roman numeral.
    *
    */
@@ -158,6 +236,71 @@ namespace Utils
    */
   std::string shortFileName(const QString &utffilename);
 
+  /** \brief MP3 encoding modes.
+   *
+   */
+  enum class EncodingMode: char
+  {
+    CBR = 0, /** constant bitrate.                      */
+    VBR,     /** variable bitrate with a quality level. */
+    ABR      /** average bitrate.                       */
+  };
+
+  /** \brief Destination of the pregap of the tracks of a CUE sheet, the samples between the INDEX 00
+   *         and INDEX 01 positions of a track.
+   *
+   */
+  enum class PregapPolicy: char
+  {
+    APPEND = 0, /** appended to the end of the previous track. */
+    PREPEND,    /** prepended to the start of the track.       */
+    DISCARD     /** not written to any track.                  */
+  };
+
+  /** \brief Codecs of the outputs. MP3 is encoded with LAME, the rest with the libav encoders.
+   *
+   */
+  enum class Codec: char
+  {
+    MP3 = 0, /** MPEG-1 layer III in a .mp3 file. */
+    AAC,     /** AAC LC in a .m4a file.           */
+    OPUS,    /** Opus in a .opus file.            */
+    VORBIS   /** Vorbis in a .ogg file.           */
+  };
+
+  /** \struct OutputProfile
+   * \brief Encoding settings of an additional output of the transcoding process.
+   *
+   */
+  struct OutputProfile
+  {
+    Codec        codec;       /** output codec.                                   */
+    EncodingMode mode;        /** encoding mode, only used by MP3 outputs.        */
+    int          bitrate;     /** CBR or ABR bitrate in kbps, average if not MP3. */
+    int          vbr_quality; /** VBR quality level in [0-9].                     */
+
+    OutputProfile(): codec{Codec::MP3}, mode{EncodingMode::CBR}, bitrate{128}, vbr_quality{2} {};
+
+    /** \brief Returns the name of the profile, used as the name of its output subdirectory.
+     *
+     */
+    QString name() const;
+  };
+
+  /** \brief Returns the profiles in the given text, a comma separated list of "128" (CBR), "A160" (ABR)
+   *         or "V5" (VBR) MP3 values, or "AAC128", "OPUS96" or "VORBIS160" values for the other codecs.
+   *         Invalid and repeated values are ignored.
+   * \param[in] text profiles text.
+   *
+   */
+  QList<OutputProfile> outputProfilesFromString(const QString &text);
+
+  /** \brief Returns the text representation of the given profiles.
+   * \param[in] profiles list of output profiles.
+   *
+   */
+  QString outputProfilesToString(const QList<OutputProfile> &profiles);
+
   /** \class TranscoderConfiguration
    * \brief Implements the configuration storage/management.
    *
@@ -198,6 +341,37 @@ namespace Utils
       inline int bitrate() const
       { return m_bitrate; }
 
+      /** \brief Returns the encoding mode. In ABR mode the bitrate is the average bitrate.
+       *
+       */
+      inline EncodingMode encodingMode() const
+      { return m_encoding_mode; }
+
+      /** \brief Returns the VBR quality level in [0-9], 0 is the highest quality.
+       *
+       */
+      inline int vbrQuality() const
+      { return m_vbr_quality; }
+
+      /** \brief Returns true if the output bitrate must be lowered to match the quality of lossy sources.
+       *
+       */
+      inline bool adaptBitrateToSource() const
+      { return m_adapt_bitrate_to_source; }
+
+      /** \brief Returns the minimum bitrate when adapting the output bitrate to the source. The maximum
+       *         is the configured bitrate, or the VBR quality level.
+       *
+       */
+      inline int minimumBitrate() const
+      { return m_minimum_bitrate; }
+
+      /** \brief Returns the profiles of the additional outputs of each file, written to subdirectories.
+       *
+       */
+      inline const QList<OutputProfile> &additionalProfiles() const
+      { return m_additional_profiles; }
+
       /** \brief Returns the cover picture name
        *
        */
@@ -234,6 +408,12 @@ namespace Utils
       inline const FormatConfiguration &formatConfiguration() const
       { return m_format_configuration; }
 
+      /** \brief Returns the reformatting configuration compiled.
+       *
+       */
+      inline const FormatProgram &formatProgram() const
+      { return *m_format_program; }
+
       /** \brief Returns the quality of the encoding process.
        *
        */
@@ -282,12 +462,43 @@ namespace Utils
       inline bool useCueToSplit() const
       { return m_use_CUE_to_split; }
 
+      /** \brief Returns the destination of the pregaps of the tracks when splitting with a CUE file.
+       *
+       */
+      inline PregapPolicy cuePregapPolicy() const
+      { return m_cue_pregap_policy; }
+
+      /** \brief Returns true if the number of samples of the tracks splitted with a CUE file must be
+       *         checked against the number of samples of the source.
+       *
+       */
+      inline bool verifyCueSplit() const
+      { return m_verify_CUE_split; }
+
+      /** \brief Returns true if the sources transcoded in previous runs that haven't changed must be skipped.
+       *
+       */
+      inline bool skipUnchangedFiles() const
+      { return m_skip_unchanged_files; }
+
+      /** \brief Returns true if the root directory must be watched for new files after the scan.
+       *
+       */
+      inline bool watchRootDirectory() const
+      { return m_watch_root_directory; }
+
       /** \brief Returns true if the output file name must be constructed from the metadata in the input file.
        *
        */
       inline bool useMetadataToRenameOutput() const
       { return m_use_metadata_to_rename_output; }
 
+      /** \brief Returns true if the input metadata and cover must be written as tags of the output files.
+       *
+       */
+      inline bool writeOutputTags() const
+      { return m_write_output_tags; }
+
       /** \brief Sets the root directory to start searching for files to transcode.
        * \param[in] path root directory path.
        *
@@ -309,6 +520,41 @@ namespace Utils
       inline void setBitrate(int value)
       { m_bitrate = value; }
 
+      /** \brief Sets the encoding mode.
+       * \param[in] mode encoding mode.
+       *
+       */
+      inline void setEncodingMode(EncodingMode mode)
+      { m_encoding_mode = mode; }
+
+      /** \brief Sets the VBR quality level.
+       * \param[in] value quality level in [0-9].
+       *
+       */
+      inline void setVbrQuality(int value)
+      { m_vbr_quality = value; }
+
+      /** \brief Sets if the output bitrate must be lowered to match the quality of lossy sources.
+       * \param[in] value boolean value.
+       *
+       */
+      inline void setAdaptBitrateToSource(bool value)
+      { m_adapt_bitrate_to_source = value; }
+
+      /** \brief Sets the minimum bitrate when adapting the output bitrate to the source.
+       * \param[in] value bitrate in kbps.
+       *
+       */
+      inline void setMinimumBitrate(int value)
+      { m_minimum_bitrate = value; }
+
+      /** \brief Sets the profiles of the additional outputs of each file.
+       * \param[in] profiles list of output profiles.
+       *
+       */
+      inline void setAdditionalProfiles(const QList<OutputProfile> &profiles)
+      { m_additional_profiles = profiles; }
+
       /** \brief Sets the file name for the cover picture file.
        * \param[in] filename cover file name without extension.
        *
@@ -349,7 +595,7 @@ namespace Utils
        *
        */
       inline void setFormatConfiguration(const FormatConfiguration& configuration)
-      { m_format_configuration = configuration; }
+      { m_format_configuration = configuration; m_format_program = std::make_shared<const FormatProgram>(m_format_configuration); }
 
       /** \brief Sets the quality of the encoding process.
        * \param[in] value quality value according to lame encoder.
@@ -370,7 +616,7 @@ namespace Utils
        *
        */
       inline void setReformatOutputFilename(bool value)
-      { m_format_configuration.apply = value; }
+      { m_format_configuration.apply = value; m_format_program = std::make_shared<const FormatProgram>(m_format_configuration); }
 
       /** \brief Sets if the tags of input mp3 files must be deleted.
        * \param[in] value Boolean value.
@@ -407,6 +653,34 @@ namespace Utils
       inline void setUseCueToSplit(bool value)
       { m_use_CUE_to_split = value; }
 
+      /** \brief Sets the destination of the pregaps of the tracks when splitting with a CUE file.
+       * \param[in] policy pregap policy.
+       *
+       */
+      inline void setCuePregapPolicy(PregapPolicy policy)
+      { m_cue_pregap_policy = policy; }
+
+      /** \brief Sets if the number of samples of the tracks splitted with a CUE file must be checked.
+       * \param[in] value boolean value.
+       *
+       */
+      inline void setVerifyCueSplit(bool value)
+      { m_verify_CUE_split = value; }
+
+      /** \brief Sets if the sources transcoded in previous runs that haven't changed must be skipped.
+       * \param[in] value boolean value.
+       *
+       */
+      inline void setSkipUnchangedFiles(bool value)
+      { m_skip_unchanged_files = value; }
+
+      /** \brief Sets if the root directory must be watched for new files after the scan.
+       * \param[in] value boolean value.
+       *
+       */
+      inline void setWatchRootDirectory(bool value)
+      { m_watch_root_directory = value; }
+
       /** \brief Sets if the output file name must be constructed from the title and track metadata in the input file.
        * \param[in] value boolean value.
        *
@@ -414,6 +688,13 @@ namespace Utils
       inline void setUseMetadataToRenameOutput(bool value)
       { m_use_metadata_to_rename_output = value; }
 
+      /** \brief Sets if the input metadata and cover must be written as tags of the output files.
+       * \param[in] value boolean value.
+       *
+       */
+      inline void setWriteOutputTags(bool value)
+      { m_write_output_tags = value; }
+
     private:
       QString m_root_directory;                  /** last used directory.                                                         */
       int     m_number_of_threads;               /** number of threads to use.                                                    */
@@ -422,6 +703,10 @@ namespace Utils
       bool    m_transcode_module;                /** true to transcode module files to mp3, false otherwise.                      */
       bool    m_strip_tags_from_MP3;             /** true to remove metadata from mp3 files, false otherwise.                     */
       bool    m_use_CUE_to_split;                /** true to use CUE files to split audio files, false otherwise.                 */
+      PregapPolicy m_cue_pregap_policy;          /** destination of the pregaps of the CUE tracks.                                */
+      bool    m_verify_CUE_split;                /** true to check the number of samples of the CUE tracks.                       */
+      bool    m_skip_unchanged_files;            /** true to skip the sources transcoded in previous runs that haven't changed.   */
+      bool    m_watch_root_directory;            /** true to keep transcoding the files added to the root directory.              */
       bool    m_rename_input_on_success;         /** true to rename the output file on a successful transcoding, false otherwise. */
       QString m_renamed_input_extension;         /** extension to add to succesfully transcoded audio files.                      */
       bool    m_use_metadata_to_rename_output;   /** use metadata if found to rename the output mp3 file.                         */
@@ -430,9 +715,16 @@ namespace Utils
       QString m_cover_picture_name;              /** name of the cover picture file.                                              */
       int     m_bitrate;                         /** mp3 output file bitrate.                                                     */
       int     m_quality;                         /** mp3 output file quality level.                                               */
+      EncodingMode m_encoding_mode;              /** mp3 output file encoding mode.                                               */
+      int     m_vbr_quality;                     /** mp3 output file VBR quality level.                                           */
+      bool    m_adapt_bitrate_to_source;         /** true to lower the output bitrate to the quality of lossy sources.            */
+      int     m_minimum_bitrate;                 /** minimum output bitrate when adapting it to the source.                       */
+      QList<OutputProfile> m_additional_profiles; /** profiles of the additional outputs of each file.                           */
       bool    m_create_M3U_files;                /** true to create playlists after the transcoding process.                      */
+      bool    m_write_output_tags;               /** true to write the input metadata as tags of the output files.                */
 
-      FormatConfiguration m_format_configuration; /** title formatting configuration. */
+      FormatConfiguration                  m_format_configuration; /** title formatting configuration.                    */
+      std::shared_ptr<const FormatProgram> m_format_program;       /** compiled formatting configuration, shared by copies. */
 
       /** settings key strings. */
       static const QString ROOT_DIRECTORY;
@@ -442,6 +734,10 @@ namespace Utils
       static const QString TRANSCODE_MODULE;
       static const QString STRIP_MP3;
       static const QString USE_CUE_SHEET;
+      static const QString CUE_PREGAP_POLICY;
+      static const QString VERIFY_CUE_SPLIT;
+      static const QString SKIP_UNCHANGED_FILES;
+      static const QString WATCH_ROOT_DIRECTORY;
       static const QString RENAME_INPUT_ON_SUCCESS;
       static const QString RENAMED_INPUT_EXTENSION;
       static const QString USE_METADATA_TO_RENAME;
@@ -450,7 +746,13 @@ namespace Utils
       static const QString COVER_PICTURE_NAME;
       static const QString BITRATE;
       static const QString QUALITY;
+      static const QString ENCODING_MODE;
+      static const QString VBR_QUALITY;
+      static const QString ADAPT_BITRATE;
+      static const QString MINIMUM_BITRATE;
+      static const QString ADDITIONAL_PROFILES;
       static const QString CREATE_M3U_FILES;
+      static const QString WRITE_OUTPUT_TAGS;
       static const QString REFORMAT_APPLY;
       static const QString REFORMAT_CHARS_TO_DELETE;
       static const QString REFORMAT_CHARS_TO_REPLACE_FROM;
@@ -19,42 +19,104 @@
 
 // Project
 #include "Worker.h"
+#include "MP3File.h"
+#include "DirectoryIndex.h"
+#include "DirectoryContext.h"
+#include "LibraryIndex.h"
+#include "RunJournal.h"
 
 // C++
+#include <algorithm>
 #include <cstring>
+#include <new>
 #include <fileapi.h>
 #include <io.h>
 
+QMutex Worker::s_threads_mutex;
+int    Worker::s_threads_budget  = 1;
+int    Worker::s_threads_in_use  = 0;
+int    Worker::s_running_workers = 0;
+int    Worker::s_pending_jobs    = 0;
+
+QMutex    Worker::s_statistics_mutex;
+long long Worker::s_bytes_saved = 0;
+QMap<QString, Worker::Conversion_statistics> Worker::s_conversions;
+
+// MP3 bitrates and average bitrates of the VBR quality levels, in kbps.
+const QList<int> MP3_BITRATES = { 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+const QList<int> VBR_BITRATES = { 245, 225, 190, 175, 165, 130, 115, 100, 85, 65 };
+
 //-----------------------------------------------------------------
 Worker::Worker(const QFileInfo &source_info, const Utils::TranscoderConfiguration &configuration)
 : m_source_info  (source_info)
 , m_source_path  (m_source_info.absoluteFilePath().remove(m_source_info.absoluteFilePath().split('/').last()))
 , m_configuration(configuration)
 , m_fail         {false}
+, m_source_samples{0}
+, m_index_name   {m_source_info.absoluteFilePath()}
 , m_num_tracks   {0}
 , m_stop         {false}
-, m_gfp          {nullptr}
+, m_decoder_threads{0}
+, m_encoded_samples{0}
+, m_written_samples{0}
+, m_skipped_samples{0}
+, m_encode_calls   {0}
+, m_batch_buffers  {nullptr, nullptr}
+, m_batch_samples  {0}
 {
-  std::memset(&m_mp3_buffer, 0, MP3_BUFFER_SIZE);
+  Utils::OutputProfile profile;
+  profile.mode        = m_configuration.encodingMode();
+  profile.bitrate     = m_configuration.bitrate();
+  profile.vbr_quality = m_configuration.vbrQuality();
+
+  m_outputs.push_back(std::make_unique<Output>(profile, QString(), m_configuration.quality()));
+
+  // additional outputs are written to a subdirectory named after their profile.
+  for(const auto &additional: m_configuration.additionalProfiles())
+  {
+    m_outputs.push_back(std::make_unique<Output>(additional, additional.name() + QString("/"), m_configuration.quality()));
+  }
+
+  QMutexLocker lock(&s_threads_mutex);
+  ++s_running_workers;
+  ++s_threads_in_use;
 }
 
 //-----------------------------------------------------------------
 Worker::~Worker()
 {
-  if((has_been_cancelled() && m_configuration.deleteOutputOnCancellation()) || has_failed())
+  release_decoder_threads();
+
+  for(auto buffer: m_batch_buffers)
+  {
+    if(buffer) ::operator delete[](buffer, std::align_val_t{BATCH_ALIGNMENT});
+  }
+
+  {
+    QMutexLocker lock(&s_threads_mutex);
+    --s_running_workers;
+    --s_threads_in_use;
+  }
+
+  // the destination being written is in its temporary file, the previous ones are complete. it's only kept
+  // if the user cancelled the conversion and asked to keep the partial outputs, otherwise it's an error.
+  const bool keep_partial = has_been_cancelled() && !m_configuration.deleteOutputOnCancellation() && !has_failed();
+  for(auto &output: m_outputs)
   {
-    if(m_mp3_file_stream.isOpen())
+    if(!output->file.isOpen()) continue;
+
+    output->file.close();
+
+    const auto temporal = output->file.fileName();
+    if(!keep_partial)
     {
-      m_mp3_file_stream.close();
+      QFile::remove(temporal);
     }
-
-    if(!m_destinations.empty())
+    else
     {
-      auto mp3_file = m_source_path + m_destinations.first().name;
-      if(QFile::exists(mp3_file))
-      {
-        QFile::remove(mp3_file);
-      }
+      const auto output_file = temporal.chopped(Utils::TEMPORAL_FILE_EXTENSION.length());
+      QFile::remove(output_file);
+      output->file.rename(output_file);
     }
   }
 
@@ -66,6 +128,16 @@ Worker::~Worker()
   }
 }
 
+//-----------------------------------------------------------------
+void Worker::update_library_index()
+{
+  // the renamed inputs aren't found again by the scan.
+  if(!m_configuration.skipUnchangedFiles() || m_source_info.isDir() || m_output_files.isEmpty()) return;
+  if(m_configuration.renameInputOnSuccess() && !Utils::isMP3File(m_source_info)) return;
+
+  LibraryIndex::add(m_index_name, m_output_files);
+}
+
 //-----------------------------------------------------------------
 void Worker::stop()
 {
@@ -86,147 +158,243 @@ bool Worker::has_failed()
 }
 
 //-----------------------------------------------------------------
-void Worker::run()
+void Worker::set_threads_budget(const int threads)
 {
-  if(check_input_file_permissions() && check_output_file_permissions())
-  {
-    run_implementation();
-  }
+  QMutexLocker lock(&s_threads_mutex);
+  s_threads_budget = std::max(1, threads);
+}
 
-  emit progress(100);
+//-----------------------------------------------------------------
+void Worker::set_pending_jobs(const int jobs)
+{
+  QMutexLocker lock(&s_threads_mutex);
+  s_pending_jobs = std::max(0, jobs);
+}
+
+//-----------------------------------------------------------------
+long long Worker::bytes_saved()
+{
+  QMutexLocker lock(&s_statistics_mutex);
+  return s_bytes_saved;
+}
+
+//-----------------------------------------------------------------
+QMap<QString, Worker::Conversion_statistics> Worker::conversion_statistics()
+{
+  QMutexLocker lock(&s_statistics_mutex);
+  return s_conversions;
+}
+
+//-----------------------------------------------------------------
+void Worker::reset_statistics()
+{
+  QMutexLocker lock(&s_statistics_mutex);
+  s_bytes_saved = 0;
+  s_conversions.clear();
+}
+
+//-----------------------------------------------------------------
+void Worker::add_conversion_statistics(const QString &codec, const long long decoded, const long long converted)
+{
+  QMutexLocker lock(&s_statistics_mutex);
+  auto &statistics = s_conversions[codec];
+  statistics.decoded   += decoded;
+  statistics.converted += converted;
 }
 
 //-----------------------------------------------------------------
-int Worker::init_lame()
+Sample_format Worker::preferred_sample_format() const
 {
-  Q_ASSERT(m_information.init);
+  return m_outputs.front()->encoder->preferred_format();
+}
+
+//-----------------------------------------------------------------
+int Worker::acquire_decoder_threads()
+{
+  QMutexLocker lock(&s_threads_mutex);
+
+  if(m_decoder_threads != 0) return m_decoder_threads + 1;
 
-  m_gfp = lame_init();
+  // pending jobs will need a thread each, the rest can be shared among the running workers.
+  const auto free_threads = s_threads_budget - s_threads_in_use - s_pending_jobs;
+  const auto share        = s_threads_budget / std::max(1, s_running_workers + s_pending_jobs);
 
-  lame_set_num_channels (m_gfp, m_information.num_channels);
-  lame_set_in_samplerate(m_gfp, m_information.samplerate);
-  lame_set_brate        (m_gfp, m_configuration.bitrate());
-  lame_set_quality      (m_gfp, m_configuration.quality());
-  lame_set_mode         (m_gfp, m_information.num_channels == 2 ? MPEG_mode_e::STEREO : MPEG_mode_e::MONO);
-  lame_set_bWriteVbrTag (m_gfp, 0);
-  lame_set_copyright    (m_gfp, 0);
-  lame_set_original     (m_gfp, 0);
+  m_decoder_threads = std::max(0, std::min(free_threads, share - 1));
+  s_threads_in_use += m_decoder_threads;
 
-  return lame_init_params(m_gfp);
+  return m_decoder_threads + 1;
 }
 
 //-----------------------------------------------------------------
-void Worker::deinit_lame()
+void Worker::release_decoder_threads()
 {
-  lame_close(m_gfp);
+  QMutexLocker lock(&s_threads_mutex);
+
+  s_threads_in_use -= m_decoder_threads;
+  m_decoder_threads = 0;
 }
 
 //-----------------------------------------------------------------
-void Worker::lame_encoder_flush()
+void Worker::run()
 {
-  auto flush_bytes = lame_encode_flush(m_gfp, m_mp3_buffer, MP3_BUFFER_SIZE);
-  if (flush_bytes != 0)
+  const bool journal = !m_source_info.isDir();
+  if(journal)
+  {
+    RunJournal::job_started(m_source_info.absoluteFilePath());
+  }
+
+  if(check_input_file_permissions() && check_output_file_permissions())
+  {
+    run_implementation();
+
+    if(!has_been_cancelled() && !has_failed())
+    {
+      update_library_index();
+    }
+  }
+
+  if(journal)
   {
-    m_mp3_file_stream.write(reinterpret_cast<char *>(&m_mp3_buffer), flush_bytes);
+    if(!has_been_cancelled() && !has_failed())
+    {
+      RunJournal::job_finished(m_source_info.absoluteFilePath());
+    }
+    else
+    {
+      RunJournal::job_failed(m_source_info.absoluteFilePath());
+    }
   }
+
+  emit progress(100);
 }
 
 //-----------------------------------------------------------------
-bool Worker::lame_encode_internal_buffer(unsigned int buffer_start, unsigned int buffer_length, unsigned char *buffer_L, unsigned char *buffer_R)
+bool Worker::encode(unsigned int buffer_start, unsigned int buffer_length, unsigned char *buffer1, unsigned char *buffer2)
 {
-  buffer_start *= bytes_per_sample();
+  // interleaved buffers have the samples of all channels one after another.
+  buffer_start *= bytes_per_sample() * (is_planar() ? 1 : m_information.num_channels);
 
-  int output_bytes = 0;
-  auto buffer_pointer_L = buffer_L + (buffer_start);
-  auto buffer_pointer_R = buffer_R + (buffer_start);
+  auto buffer_pointer1 = buffer1 + buffer_start;
+  auto buffer_pointer2 = buffer2 ? buffer2 + buffer_start : nullptr;
 
-  switch(m_information.format)
+  // every output is fed the same samples.
+  for(auto &output: m_outputs)
   {
-    case Sample_format::SIGNED_16:
-      output_bytes = lame_encode_buffer_interleaved(m_gfp, reinterpret_cast<short int *>(buffer_pointer_L), buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      break;
-    case Sample_format::FLOAT:
-      output_bytes = lame_encode_buffer_interleaved_ieee_float(m_gfp, reinterpret_cast<const float *>(buffer_pointer_L), buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      break;
-    case Sample_format::DOUBLE:
-      output_bytes = lame_encode_buffer_interleaved_ieee_double(m_gfp, reinterpret_cast<const double *>(buffer_pointer_L), buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      break;
-    case Sample_format::SIGNED_16_PLANAR:
-      output_bytes = lame_encode_buffer(m_gfp, reinterpret_cast<const short int *>(buffer_pointer_L), reinterpret_cast<const short int *>(buffer_pointer_R), buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      break;
-    case Sample_format::SIGNED_32_PLANAR:
-      output_bytes = lame_encode_buffer_long2(m_gfp, reinterpret_cast<const long int *>(buffer_pointer_L), reinterpret_cast<const long int *>(buffer_pointer_R), buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      break;
-    case Sample_format::FLOAT_PLANAR:
-      output_bytes = lame_encode_buffer_ieee_float(m_gfp, reinterpret_cast<const float *>(buffer_pointer_L), reinterpret_cast<const float *>(buffer_pointer_R), buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      break;
-    case Sample_format::DOUBLE_PLANAR:
-      output_bytes = lame_encode_buffer_ieee_double(m_gfp, reinterpret_cast<const double *>(buffer_pointer_L), reinterpret_cast<const double *>(buffer_pointer_R), buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      break;
-    case Sample_format::SIGNED_32: // not natively supported by lame, we need to make it planar. it's a common sample format in flac files.
-      {
-        long int bufferL[buffer_length];
-        long int bufferR[buffer_length];
-        auto L_pointer = reinterpret_cast<long int *>(buffer_L);
-
-        for(unsigned long i = 0; i < buffer_length * 2; i += 2)
-        {
-          bufferL[i/2] = L_pointer[i];
-          bufferR[i/2] = L_pointer[i+1];
-        }
-        output_bytes = lame_encode_buffer_long2(m_gfp, bufferL, bufferR, buffer_length, m_mp3_buffer, MP3_BUFFER_SIZE);
-      }
-      break;
-      // Unsupported formats
-    default:
-    case Sample_format::UNSIGNED_8:
-    case Sample_format::UNSIGNED_8_PLANAR:
+    if (!output->encoder->encode(buffer_pointer1, buffer_pointer2, buffer_length))
+    {
+      auto source_file = m_source_info.absoluteFilePath();
+      emit error_message(QString("Error in encode phase for file '%1', sample format is '%2'. %3.").arg(source_file).arg(sample_format_string()).arg(output->encoder->error()));
       m_fail = true;
       return false;
-      break;
+    }
+  }
+
+  m_encoded_samples += buffer_length;
+  m_written_samples += buffer_length;
+  ++m_encode_calls;
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool Worker::encode_samples(unsigned int nb_samples, unsigned char *buffer1, unsigned char *buffer2)
+{
+  // blocks as big as the batch don't need to be copied.
+  if(m_batch_samples == 0 && nb_samples >= BATCH_SAMPLES)
+  {
+    return encode_block(nb_samples, buffer1, buffer2);
   }
 
-  if (output_bytes < 0)
+  const auto planar        = is_planar();
+  const auto sample_bytes  = bytes_per_sample() * (planar ? 1 : m_information.num_channels);
+  const auto buffers_count = (planar && m_information.num_channels > 1 && buffer2) ? 2 : 1;
+
+  if(sample_bytes <= 0) return encode_block(nb_samples, buffer1, buffer2);
+
+  for(int i = 0; i < buffers_count; ++i)
   {
-    switch (output_bytes)
+    if(!m_batch_buffers[i])
     {
-      case -1:
-        emit error_message(QString("Error in LAME code stage, mp3 buffer was too small."));
-        break;
-      case -2:
-        emit error_message(QString("Error in LAME code stage, malloc() problem."));
-        break;
-      case -3:
-        emit error_message(QString("Error in LAME code stage, lame_init_params() not called."));
-        break;
-      case -4:
-        emit error_message(QString("Error in LAME code stage, psycho acoustic problems."));
-        break;
-      default:
-        Q_ASSERT(false);
+      // the format doesn't change, the buffers are allocated once for the largest sample size.
+      const auto size = BATCH_SAMPLES * sizeof(double) * std::max(1, m_information.num_channels);
+      m_batch_buffers[i] = static_cast<unsigned char *>(::operator new[](size, std::align_val_t{BATCH_ALIGNMENT}));
     }
-
-    m_fail = true;
-    return false;
   }
 
-  if (output_bytes > 0)
+  unsigned int copied = 0;
+  while(copied < nb_samples)
   {
-    m_mp3_file_stream.write(reinterpret_cast<char *>(&m_mp3_buffer), output_bytes);
+    const auto count = std::min(nb_samples - copied, BATCH_SAMPLES - m_batch_samples);
+
+    std::memcpy(m_batch_buffers[0] + m_batch_samples * sample_bytes, buffer1 + copied * sample_bytes, count * sample_bytes);
+    if(buffers_count == 2)
+    {
+      std::memcpy(m_batch_buffers[1] + m_batch_samples * sample_bytes, buffer2 + copied * sample_bytes, count * sample_bytes);
+    }
+
+    copied          += count;
+    m_batch_samples += count;
+
+    if(m_batch_samples == BATCH_SAMPLES && !flush_samples())
+    {
+      return false;
+    }
   }
 
   return true;
 }
 
 //-----------------------------------------------------------------
-bool Worker::encode(unsigned int buffer_start, unsigned int buffer_length, unsigned char *buffer1, unsigned char *buffer2)
+bool Worker::flush_samples()
 {
-  if (!lame_encode_internal_buffer(buffer_start, buffer_length, buffer1, buffer2))
+  if(m_batch_samples == 0) return true;
+
+  // emptied before encoding, the block can close and open destinations.
+  const auto samples = m_batch_samples;
+  m_batch_samples = 0;
+
+  return encode_block(samples, m_batch_buffers[0], m_batch_buffers[1]);
+}
+
+//-----------------------------------------------------------------
+bool Worker::encode_block(unsigned int nb_samples, unsigned char *buffer1, unsigned char *buffer2)
+{
+  // positions are absolute, so the boundaries don't drift with the size of the blocks.
+  unsigned int position = 0;
+  while(position < nb_samples)
   {
-    auto source_file = m_source_info.absoluteFilePath();
-    emit error_message(QString("Error in encode phase for file '%1'. Unknown sample format, format is '%2'").arg(source_file).arg(sample_format_string()));
-    m_fail = true;
-    return false;
+    const auto remaining = nb_samples - position;
+    const auto &current  = destination();
+
+    // discarded pregap before the start of the destination.
+    if(m_source_samples < current.start)
+    {
+      const auto skipped = static_cast<unsigned int>(std::min<long long>(current.start - m_source_samples, remaining));
+      m_source_samples  += skipped;
+      m_skipped_samples += skipped;
+      position          += skipped;
+      continue;
+    }
+
+    if(current.end == 0 || m_source_samples + remaining < current.end)
+    {
+      m_source_samples += remaining;
+      return encode(position, remaining, buffer1, buffer2);
+    }
+
+    const auto count = static_cast<unsigned int>(std::max<long long>(0, current.end - m_source_samples));
+    if(count > 0 && !encode(position, count, buffer1, buffer2))
+    {
+      return false;
+    }
+
+    m_source_samples += count;
+    position         += count;
+
+    if(!close_destination_file() || !open_next_destination_file())
+    {
+      return false;
+    }
   }
 
   return true;
@@ -235,62 +403,287 @@ bool Worker::encode(unsigned int buffer_start, unsigned int buffer_length, unsig
 //-----------------------------------------------------------------
 bool Worker::open_next_destination_file()
 {
-  Q_ASSERT(!m_mp3_file_stream.isOpen());
-
   if(m_destinations.empty())
   {
     m_destinations = compute_destinations();
     m_num_tracks   = m_destinations.size();
+
+    for(auto &output: m_outputs)
+    {
+      select_output_bitrate(*output);
+    }
+  }
+
+  auto destination = m_destinations.first();
+
+  m_encoded_samples = 0;
+  m_encode_calls    = 0;
+  m_encode_timer.start();
+
+  for(auto &output: m_outputs)
+  {
+    if(!open_output_file(*output, destination))
+    {
+      return false;
+    }
+  }
+
+  auto source_name = m_source_info.absoluteFilePath().split('/').last();
+
+  if(number_of_tracks() != 1)
+  {
+    emit information_message(QString("Extracting '%1' from '%2'.").arg(destination.name).arg(source_name));
+  }
+  else
+  {
+    emit information_message(QString("Transcoding '%1' from '%2'.").arg(destination.name).arg(source_name));
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------
+bool Worker::open_output_file(Output &output, const Destination &destination)
+{
+  Q_ASSERT(!output.file.isOpen());
+
+  if(!output.directory.isEmpty() && !QDir(m_source_path).mkpath(output.directory))
+  {
+    emit error_message(QString("Couldn't create directory '%1'.").arg(m_source_path + output.directory));
+    m_fail = true;
+    return false;
+  }
+
+  // written to a temporary file renamed when it's complete, an interrupted process doesn't leave a
+  // partial output with the name of a finished one.
+  auto output_file = output_file_name(output, destination) + Utils::TEMPORAL_FILE_EXTENSION;
+  RunJournal::output_created(output_file);
+
+  output.file.setFileName(output_file);
+  auto opened = output.file.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Unbuffered);
+
+  if(!output.file.isOpen() || !opened)
+  {
+    emit error_message(QString("Couldn't open destination file: %1. Error is: %2.").arg(output_file).arg(output.file.error()));
+    m_fail = true;
+    return false;
   }
 
-  std::memset(m_mp3_buffer, 0, MP3_BUFFER_SIZE);
+  output.tag_size = 0;
+
+  const auto writeTags = m_configuration.writeOutputTags();
 
-  if(0 != init_lame())
+  if(writeTags && (m_information.passthrough || output.encoder->usesID3Tags()) && !write_output_tag(output, destination))
+  {
+    return false;
+  }
+
+  Encoder::Input input;
+  input.format     = m_information.format;
+  input.samplerate = m_information.samplerate;
+  input.channels   = m_information.num_channels;
+
+  // the encoder writes its stream after the tag.
+  if(!m_information.passthrough && !output.encoder->init(output.profile, input, writeTags ? output_tags(destination) : QMap<QString, QString>(), &output.file))
   {
     auto music_file = m_source_info.absoluteFilePath().replace('/',QDir::separator());
-    emit error_message(QString("Error in LAME library init stage for '%1'").arg(music_file));
+    emit error_message(QString("Error in encoder init stage for '%1'. %2.").arg(music_file).arg(output.encoder->error()));
     m_fail = true;
     return false;
   }
 
-  auto destination = m_destinations.first();
-  auto mp3_file = m_source_path + destination.name;
-  m_mp3_file_stream.setFileName(mp3_file);
-  auto opened = m_mp3_file_stream.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Unbuffered);
+  return true;
+}
 
-  if(!m_mp3_file_stream.isOpen() || !opened)
+//-----------------------------------------------------------------
+bool Worker::close_destination_file()
+{
+  // the outputs of a failed worker or a failed final encode are incomplete, they are removed with the worker.
+  if(m_fail || !flush_samples())
   {
-    emit error_message(QString("Couldn't open destination file: %1. Error is: %2.").arg(mp3_file).arg(m_mp3_file_stream.error()));
     m_fail = true;
     return false;
   }
 
-  auto source_name = m_source_info.absoluteFilePath().split('/').last();
+  const auto closed_destination = m_destinations.takeFirst();
 
-  if(number_of_tracks() != 1)
+  for(auto &output: m_outputs)
   {
-    emit information_message(QString("Extracting '%1' from '%2'.").arg(destination.name).arg(source_name));
+    close_output_file(*output, closed_destination);
   }
-  else
+
+  return !m_fail;
+}
+
+//-----------------------------------------------------------------
+void Worker::close_output_file(Output &output, const Destination &destination)
+{
+  if(!m_information.passthrough && !output.encoder->finish())
   {
-    emit information_message(QString("Transcoding '%1' from '%2'.").arg(destination.name).arg(source_name));
+    emit error_message(QString("Error finishing destination file '%1'. %2.").arg(output.file.fileName()).arg(output.encoder->error()));
+    m_fail = true;
+  }
+
+  // an incomplete output never gets the final name.
+  if(m_fail)
+  {
+    output.file.close();
+    QFile::remove(output.file.fileName());
+    return;
+  }
+
+  if(output.tag_size > 0)
+  {
+    update_output_tag(output, destination);
+  }
+
+  if(!m_information.passthrough && m_encoded_samples > 0 && m_information.samplerate > 0)
+  {
+    const auto duration = static_cast<double>(m_encoded_samples) / m_information.samplerate;
+    const auto elapsed  = std::max<qint64>(1, m_encode_timer.elapsed());
+
+    emit information_message(QString("Encoded '%1' in %2 mode: %3 KiB, %4x realtime, %5 encoder calls per second.").arg(output.directory + QFileInfo(output_file_name(output, destination)).fileName())
+                             .arg(output.profile.name()).arg(output.file.size() / 1024).arg(duration * 1000 / elapsed, 0, 'f', 1).arg(m_encode_calls * 1000.0 / elapsed, 0, 'f', 1));
+  }
+
+  // estimated from the nominal bitrates, the actual size of VBR files depends on the content.
+  const auto saved_bitrate = nominal_bitrate(output.requested) - nominal_bitrate(output.profile);
+  if(saved_bitrate > 0 && m_information.samplerate > 0)
+  {
+    QMutexLocker lock(&s_statistics_mutex);
+    s_bytes_saved += (m_encoded_samples * saved_bitrate * 125) / m_information.samplerate;
+  }
+
+  output.file.flush();
+  FlushFileBuffers((HANDLE)_get_osfhandle(output.file.handle()));
+  output.file.close();
+
+  const auto output_file = output_file_name(output, destination);
+  QFile::remove(output_file);
+  if(!output.file.rename(output_file))
+  {
+    emit error_message(QString("Couldn't rename '%1' to '%2'. Error is: %3.").arg(output.file.fileName()).arg(output_file).arg(output.file.errorString()));
+    m_fail = true;
+    return;
+  }
+
+  // the playlists are created from the index, the encoded samples give the duration.
+  long long duration = -1;
+  if(!m_information.passthrough && m_information.samplerate > 0)
+  {
+    duration = (m_encoded_samples * 1000) / m_information.samplerate;
+  }
+
+  DirectoryIndex::add_output(output.file.fileName(), duration);
+
+  m_output_files << output.file.fileName().mid(m_source_path.length());
+}
+
+//-----------------------------------------------------------------
+QByteArray Worker::output_tag(const Destination &destination, const int padding) const
+{
+  MP3File::Information tags;
+  tags.title      = destination.metadata.title;
+  tags.artist     = destination.metadata.artist;
+  tags.album      = destination.metadata.album;
+  tags.track      = destination.metadata.track;
+  tags.disc       = destination.metadata.disc;
+  tags.cover      = m_output_cover;
+  tags.cover_mime = m_output_cover_mime;
+
+  long long length = 0;
+  if(m_information.samplerate > 0)
+  {
+    length = (m_encoded_samples * 1000) / m_information.samplerate;
+  }
+
+  return MP3File::id3v2_tag(tags, length, padding);
+}
+
+//-----------------------------------------------------------------
+QMap<QString, QString> Worker::output_tags(const Destination &destination) const
+{
+  QMap<QString, QString> tags;
+
+  const auto &metadata = destination.metadata;
+  if(!metadata.title.isEmpty())  tags.insert("title",  metadata.title);
+  if(!metadata.artist.isEmpty()) tags.insert("artist", metadata.artist);
+  if(!metadata.album.isEmpty())  tags.insert("album",  metadata.album);
+  if(metadata.track > 0)         tags.insert("track",  QString::number(metadata.track));
+  if(metadata.disc > 0)          tags.insert("disc",   QString::number(metadata.disc));
+
+  return tags;
+}
+
+//-----------------------------------------------------------------
+QString Worker::output_file_name(const Output &output, const Destination &destination) const
+{
+  auto name = destination.name;
+
+  const auto extension = output.encoder->extension();
+  if(extension != "mp3" && name.endsWith(".mp3", Qt::CaseInsensitive))
+  {
+    name = name.left(name.length() - 3) + extension;
+  }
+
+  return m_source_path + output.directory + name;
+}
+
+//-----------------------------------------------------------------
+bool Worker::write_output_tag(Output &output, const Destination &destination)
+{
+  const auto tag = output_tag(destination, TAG_PADDING);
+
+  if(output.file.write(tag) != tag.size())
+  {
+    emit error_message(QString("Error writing tags to destination file '%1'. Error is: %2.").arg(output.file.fileName()).arg(output.file.errorString()));
+    m_fail = true;
+    return false;
   }
 
+  output.tag_size = tag.size();
+
   return true;
 }
 
 //-----------------------------------------------------------------
-void Worker::close_destination_file()
+void Worker::update_output_tag(Output &output, const Destination &destination)
+{
+  // the length is only known after encoding, the rest of the tag doesn't change.
+  if(m_encoded_samples == 0) return;
+
+  const auto tag_size = output_tag(destination, 0).size();
+  if(tag_size > output.tag_size)
+  {
+    emit information_message(QString("The tags of '%1' don't fit in the written tag, the track length won't be updated.").arg(output.file.fileName()));
+    return;
+  }
+
+  const auto tag = output_tag(destination, output.tag_size - tag_size);
+  const auto position = output.file.pos();
+
+  if(!output.file.seek(0) || output.file.write(tag) != tag.size() || !output.file.seek(position))
+  {
+    emit error_message(QString("Error updating the tags of destination file '%1'. Error is: %2.").arg(output.file.fileName()).arg(output.file.errorString()));
+  }
+}
+
+//-----------------------------------------------------------------
+bool Worker::write_compressed_data(const unsigned char *data, const int size)
 {
-  m_destinations.removeFirst();
+  if(size <= 0) return true;
 
-  lame_encoder_flush();
+  // compressed data can only be copied to the main output.
+  auto &file = m_outputs.front()->file;
 
-  m_mp3_file_stream.flush();
-  FlushFileBuffers((HANDLE)_get_osfhandle(m_mp3_file_stream.handle()));
-  m_mp3_file_stream.close();
+  if(file.write(reinterpret_cast<const char *>(data), size) != size)
+  {
+    emit error_message(QString("Error writing to destination file '%1'. Error is: %2.").arg(file.fileName()).arg(file.errorString()));
+    m_fail = true;
+    return false;
+  }
 
-  deinit_lame();
+  return true;
 }
 
 //-----------------------------------------------------------------
@@ -305,6 +698,39 @@ const int Worker::number_of_tracks() const
   return m_num_tracks;
 }
 
+//-----------------------------------------------------------------
+void Worker::verify_split(const long long expected_samples)
+{
+  const auto source_name = m_source_info.absoluteFilePath();
+  QStringList errors;
+
+  if(m_written_samples + m_skipped_samples != m_source_samples)
+  {
+    errors << QString("%1 samples written and %2 discarded from %3 decoded samples").arg(m_written_samples).arg(m_skipped_samples).arg(m_source_samples);
+  }
+
+  if(expected_samples > 0 && expected_samples != m_source_samples)
+  {
+    errors << QString("%1 samples decoded from a stream of %2 samples").arg(m_source_samples).arg(expected_samples);
+  }
+
+  if(!m_destinations.isEmpty())
+  {
+    errors << QString("%1 tracks start after the end of the source").arg(m_destinations.size());
+  }
+
+  if(!errors.isEmpty())
+  {
+    emit error_message(QString("The split of '%1' doesn't match the source: %2.").arg(source_name).arg(errors.join(", ")));
+    return;
+  }
+
+  emit information_message(QString("Verified the split of '%1': %2 tracks with %3 samples, %4 samples of pregaps discarded.").arg(source_name)
+                                                                                                                             .arg(number_of_tracks())
+                                                                                                                             .arg(m_written_samples)
+                                                                                                                             .arg(m_skipped_samples));
+}
+
 //-----------------------------------------------------------------
 bool Worker::check_input_file_permissions()
 {
@@ -328,17 +754,17 @@ bool Worker::check_input_file_permissions()
 //-----------------------------------------------------------------
 bool Worker::check_output_file_permissions()
 {
-  auto temp_file = QString(m_source_info.absoluteFilePath()) + Utils::TEMPORAL_FILE_EXTENSION;
-  QFile file(temp_file);
-  if(!file.open(QFile::WriteOnly|QFile::Truncate))
+  // the outputs of a folder are written inside it, the ones of a file next to it. every worker of
+  // the same directory shares the result of the probe.
+  const auto directory = m_source_info.isDir() ? m_source_info.absoluteFilePath() + '/' : m_source_path;
+
+  if(!DirectoryContext::get(directory)->writable())
   {
     emit error_message(QString("Can't create files in '%1' path, check for permissions.").arg(m_source_info.absoluteFilePath()));
     m_fail = true;
     return false;
   }
 
-  file.close();
-  file.remove();
   return true;
 }
 
@@ -365,6 +791,23 @@ int Worker::bytes_per_sample() const
   return -1;
 }
 
+//-----------------------------------------------------------------
+bool Worker::is_planar() const
+{
+  switch(m_information.format)
+  {
+    case Sample_format::SIGNED_16_PLANAR:
+    case Sample_format::SIGNED_32_PLANAR:
+    case Sample_format::FLOAT_PLANAR:
+    case Sample_format::DOUBLE_PLANAR:
+    case Sample_format::UNSIGNED_8_PLANAR: return true;
+    default:
+      break;
+  }
+
+  return false;
+}
+
 //-----------------------------------------------------------------
 QString Worker::sample_format_string() const
 {
@@ -387,6 +830,69 @@ QString Worker::sample_format_string() const
   return QString("undefined");
 }
 
+//-----------------------------------------------------------------
+void Worker::select_output_bitrate(Output &output)
+{
+  auto &profile = output.profile;
+  profile = output.requested;
+
+  // the bitrate steps and quality levels are the ones of the MP3 encoder.
+  if(profile.codec != Utils::Codec::MP3) return;
+
+  if(!m_configuration.adaptBitrateToSource() || m_information.equivalent_bitrate <= 0) return;
+
+  const auto maximum = nominal_bitrate(profile);
+  const auto target  = std::clamp(m_information.equivalent_bitrate, std::min(m_configuration.minimumBitrate(), maximum), maximum);
+
+  if(profile.mode == Utils::EncodingMode::VBR)
+  {
+    // lowest quality level with an average bitrate over the target.
+    for(int level = VBR_BITRATES.size() - 1; level > profile.vbr_quality; --level)
+    {
+      if(VBR_BITRATES.at(level) >= target)
+      {
+        profile.vbr_quality = level;
+        break;
+      }
+    }
+  }
+  else
+  {
+    // lowest MP3 bitrate over the target.
+    for(const auto bitrate: MP3_BITRATES)
+    {
+      if(bitrate >= target)
+      {
+        profile.bitrate = std::min(bitrate, profile.bitrate);
+        break;
+      }
+    }
+  }
+
+  if(profile.bitrate != output.requested.bitrate || profile.vbr_quality != output.requested.vbr_quality)
+  {
+    emit information_message(QString("The quality of '%1' is equivalent to %2 kbps MP3, encoding in %3 instead of %4.").arg(m_source_info.fileName())
+                             .arg(m_information.equivalent_bitrate).arg(profile.name()).arg(output.requested.name()));
+  }
+}
+
+//-----------------------------------------------------------------
+int Worker::requested_bitrate() const
+{
+  return nominal_bitrate(m_outputs.front()->requested);
+}
+
+//-----------------------------------------------------------------
+int Worker::nominal_bitrate(const Utils::OutputProfile &profile) const
+{
+  if(profile.mode == Utils::EncodingMode::VBR)
+  {
+    return VBR_BITRATES.at(std::clamp(profile.vbr_quality, 0, static_cast<int>(VBR_BITRATES.size()) - 1));
+  }
+
+  return profile.bitrate;
+}
+
 //-----------------------------------------------------------------
 Worker::Destinations Worker::compute_destinations()
 {
@@ -394,7 +900,7 @@ Worker::Destinations Worker::compute_destinations()
 
   QString file_name;
 
-  destinations << Destination(Utils::formatString(m_source_info.absoluteFilePath(), m_configuration.formatConfiguration()), 0);
+  destinations << Destination(m_configuration.formatProgram().apply(m_source_info.absoluteFilePath(), true), 0, 0);
 
   return destinations;
 }
@@ -22,10 +22,17 @@
 
 // Project
 #include "Utils.h"
+#include "Encoder.h"
 
 // Qt
 #include <QThread>
 #include <QFileInfo>
+#include <QMutex>
+#include <QElapsedTimer>
+
+// C++
+#include <memory>
+#include <vector>
 
 // Lame
 #include <lame.h>
@@ -66,6 +73,49 @@ class Worker
      */
     bool has_failed();
 
+    /** \brief Sets the maximum number of threads that all the workers can use, including
+     *         the threads used by the decoders.
+     * \param[in] threads number of threads.
+     *
+     */
+    static void set_threads_budget(const int threads);
+
+    /** \brief Sets the number of jobs waiting to be processed. Threads that can be used by the
+     *         pending jobs won't be granted to the decoders of running workers.
+     * \param[in] jobs number of pending jobs.
+     *
+     */
+    static void set_pending_jobs(const int jobs);
+
+    /** \struct Conversion_statistics
+     * \brief Decoded bytes of a source codec and the part of them that had to be converted to the
+     *        sample format of the encoders.
+     *
+     */
+    struct Conversion_statistics
+    {
+      long long decoded;   /** bytes of decoded samples.   */
+      long long converted; /** bytes of converted samples. */
+
+      Conversion_statistics(): decoded{0}, converted{0} {};
+    };
+
+    /** \brief Returns the estimated number of bytes saved by lowering the output bitrate to the
+     *         quality of the sources since the last reset.
+     *
+     */
+    static long long bytes_saved();
+
+    /** \brief Returns the decoded and converted bytes of each source codec since the last reset.
+     *
+     */
+    static QMap<QString, Conversion_statistics> conversion_statistics();
+
+    /** \brief Resets the bytes saved by lowering the output bitrate and the conversion statistics.
+     *
+     */
+    static void reset_statistics();
+
   signals:
     /** \brief Emits a error message signal.
      * \param[in] message error message.
@@ -93,7 +143,7 @@ class Worker
      */
     virtual void run_implementation() = 0;
 
-    /** \brief Encodes the data using the lame_encode() method and emits a message
+    /** \brief Encodes the data with the encoders of the outputs and emits a message
      *         in case of error.
      * \param[in] buffer_start starting position in the data buffers to convert.
      * \param[in] buffer_length number of samples per channel in the data buffers.
@@ -103,31 +153,92 @@ class Worker
      */
     bool encode(unsigned int buffer_start, unsigned int buffer_length, unsigned char *buffer1, unsigned char *buffer2);
 
-    /** \brief Opens the next destination file, initializes the lame context and computes the number
-     *         of samples of duration if specified by the cue file.
+    /** \brief Adds the given samples to the batch of samples and encodes it when it's full. The samples
+     *         are copied, the buffers can be reused after the call. Blocks of at least BATCH_SAMPLES given
+     *         while the batch is empty are encoded without copying them.
+     * \param[in] nb_samples number of samples per channel in the data buffers.
+     * \param[in] buffer1 pointer to first buffer (main or left).
+     * \param[in] buffer2 pointer to second buffer (unused or right).
+     *
+     */
+    bool encode_samples(unsigned int nb_samples, unsigned char *buffer1, unsigned char *buffer2);
+
+    /** \brief Opens the next destination file and initializes the encoders. Computes the destinations
+     *         and their positions in the source on the first call.
      *
      */
     bool open_next_destination_file();
 
-    /** \brief Closes the destination file and de-initializes the lame context.
+    /** \brief Encodes the batched samples, closes the destination file and flushes the encoders. Returns
+     *         false and marks the worker as failed if the samples can't be encoded or the outputs closed.
+     *
+     */
+    bool close_destination_file();
+
+    /** \brief Returns the number of threads the decoder can use (at least one). The threads are taken
+     *         from the global budget, the fewer workers running the more threads are granted.
+     *
+     */
+    int acquire_decoder_threads();
+
+    /** \brief Returns the threads granted for decoding to the global budget.
+     *
+     */
+    void release_decoder_threads();
+
+    /** \brief Returns the sample format consumed by the encoder of the main output without converting it.
      *
      */
-    void close_destination_file();
+    Sample_format preferred_sample_format() const;
 
-    // sample formats, not all supported.
-    enum class Sample_format: unsigned char { UNDEFINED = 0, SIGNED_16, FLOAT, DOUBLE, SIGNED_16_PLANAR, SIGNED_32_PLANAR, FLOAT_PLANAR, DOUBLE_PLANAR, UNSIGNED_8, UNSIGNED_8_PLANAR, SIGNED_32 };
+    /** \brief Returns the nominal bitrate in kbps of the configured settings of the main output.
+     *
+     */
+    int requested_bitrate() const;
+
+    /** \brief Adds the given bytes to the conversion statistics of the codec.
+     * \param[in] codec source codec name.
+     * \param[in] decoded bytes of decoded samples.
+     * \param[in] converted bytes of converted samples.
+     *
+     */
+    static void add_conversion_statistics(const QString &codec, const long long decoded, const long long converted);
+
+    /** \brief Writes already encoded MP3 data to the destination file, bypassing the lame encoder.
+     * \param[in] data pointer to the compressed data.
+     * \param[in] size size of the data in bytes.
+     *
+     */
+    bool write_compressed_data(const unsigned char *data, const int size);
 
     // information of the source audio file
     struct Source_Info
     {
-      bool          init;         /** true if the struct has been initialized, false otherwise. */
-      int           num_channels; /** number of channels in the source file.                    */
-      long          samplerate;   /** sample rate of the source file.                           */
-      MPEG_mode_e   mode;         /** mpeg mode of the source if it's an MP3.                   */
-      Sample_format format;       /** sample format of the source file.                         */
-      bool          isFlac;       /** true if flac encoded source file.                         */
+      bool          init;               /** true if the struct has been initialized, false otherwise.                    */
+      int           num_channels;       /** number of channels in the source file.                                       */
+      long          samplerate;         /** sample rate of the source file.                                              */
+      MPEG_mode_e   mode;               /** mpeg mode of the source if it's an MP3.                                      */
+      Sample_format format;             /** sample format of the source file.                                            */
+      bool          isFlac;             /** true if flac encoded source file.                                            */
+      bool          passthrough;        /** true if the source MP3 frames are copied without encoding.                   */
+      int           equivalent_bitrate; /** MP3 bitrate with the quality of the lossy source, 0 if unknown or lossless. */
 	  
-      Source_Info(): init{false}, num_channels{-1}, samplerate{-1}, mode{MPEG_mode_e::STEREO}, format{Sample_format::UNDEFINED}, isFlac{false} {};
+      Source_Info(): init{false}, num_channels{-1}, samplerate{-1}, mode{MPEG_mode_e::STEREO}, format{Sample_format::UNDEFINED}, isFlac{false}, passthrough{false}, equivalent_bitrate{0} {};
+    };
+
+    /** \struct Metadata
+     * \brief Tags of the source file used to build the destination file names and tags.
+     *
+     */
+    struct Metadata
+    {
+      QString artist; /** track artist.                  */
+      QString title;  /** track title.                   */
+      QString album;  /** album title.                   */
+      int     track;  /** track number, 0 if unknown.    */
+      int     disc;   /** disc number, 0 if unknown.     */
+
+      Metadata(): track{0}, disc{0} {};
     };
 
     /** \struct Destination
@@ -136,11 +247,14 @@ class Worker
      */
     struct Destination
     {
-        QString       name;     /** destination file name.                                                                    */
-        long long int duration; /** duration of the destination file (there are 75 frames per second in a cue sheet duration.
-                                    0 indicates not to worry about duration and encode until the end of the source file).     */
-
-        Destination(QString destination_name, long int destination_duration): name{destination_name}, duration{destination_duration} {};
+        QString       name;     /** destination file name.                                                               */
+        long long int start;    /** position of the first sample of the destination in the source, in samples.           */
+        long long int end;      /** position after the last sample of the destination in the source, in samples. 0
+                                    indicates not to worry about duration and encode until the end of the source file.   */
+        Metadata      metadata; /** tags to write in the destination file.                                               */
+
+        Destination(QString destination_name, long long int destination_start, long long int destination_end, const Metadata &destination_metadata = Metadata())
+        : name{destination_name}, start{destination_start}, end{destination_end}, metadata{destination_metadata} {};
     };
     using Destinations = QList<Destination>;
 
@@ -154,37 +268,113 @@ class Worker
      */
     const int number_of_tracks() const;
 
-    const QFileInfo                m_source_info;   /** source file information.                  */
-    const QString                  m_source_path;   /** source file path.                         */
-    Utils::TranscoderConfiguration m_configuration; /** application configuration.                */
-    Source_Info                    m_information;   /** source file audio information.            */
-    bool                           m_fail;          /** true on process success, false otherwise. */
+    /** \brief Checks the number of samples written to the destinations against the number of samples of
+     *         the source and reports the result.
+     * \param[in] expected_samples number of samples of the source stream, or 0 if unknown.
+     *
+     */
+    void verify_split(const long long expected_samples);
+
+    static const unsigned int BATCH_SAMPLES = 65536; /** samples per channel of the batch given to the encoders. */
+
+    const QFileInfo                m_source_info;       /** source file information.                    */
+    const QString                  m_source_path;       /** source file path.                           */
+    Utils::TranscoderConfiguration m_configuration;     /** application configuration.                  */
+    Source_Info                    m_information;       /** source file audio information.              */
+    bool                           m_fail;              /** true on process success, false otherwise.   */
+    QByteArray                     m_output_cover;      /** cover picture to embed in the destinations. */
+    QString                        m_output_cover_mime; /** mime type of the cover picture.             */
+    long long                      m_source_samples;    /** position of the next source sample.         */
+    QString                        m_index_name;        /** source file name in the library index.      */
+    QStringList                    m_output_files;      /** outputs, relative to the source path.       */
 
   private:
-    /** \brief Initializes lame library structures and data to encode the pcm data.
+    static const int          TAG_PADDING     = 1024;  /** padding of the output tag to allow updating it in place. */
+    static const std::size_t  BATCH_ALIGNMENT = 64;    /** alignment of the batch buffers.                          */
+
+    /** \struct Output
+     * \brief Encoder and destination file of one of the outputs of the source. All the outputs are
+     *        fed the same samples.
+     *
+     */
+    struct Output
+    {
+      Utils::OutputProfile     requested; /** configured encoding settings.                        */
+      Utils::OutputProfile     profile;   /** encoding settings, adapted to the source if enabled. */
+      QString                  directory; /** output directory relative to the source path.        */
+      std::unique_ptr<Encoder> encoder;   /** encoder of the output.                               */
+      QFile                    file;      /** output file stream.                                  */
+      int                      tag_size;  /** size of the ID3v2 tag of the output file.            */
+
+      Output(const Utils::OutputProfile &output_profile, const QString &output_directory, const int quality)
+      : requested{output_profile}, profile{output_profile}, directory{output_directory}, encoder{Encoder::create(output_profile, quality)}, tag_size{0} {};
+    };
+
+    /** \brief Returns the ID3v2 tag for the given destination.
+     * \param[in] destination destination file information.
+     * \param[in] padding number of padding bytes at the end of the tag.
+     *
+     */
+    QByteArray output_tag(const Destination &destination, const int padding) const;
+
+    /** \brief Writes the ID3v2 tag at the start of the destination file, leaving room to update it
+     *         when the destination is closed.
+     * \param[in] output destination output.
+     * \param[in] destination destination file information.
+     *
+     */
+    bool write_output_tag(Output &output, const Destination &destination);
+
+    /** \brief Rewrites the ID3v2 tag of the destination file with the encoded length if it fits in
+     *         the space written when the file was opened.
+     * \param[in] output destination output.
+     * \param[in] destination destination file information.
      *
      */
-    int init_lame();
+    void update_output_tag(Output &output, const Destination &destination);
 
-    /** \brief Frees the structures allocated in the init stages of lame library.
+    /** \brief Returns the tags of the given destination with the libav metadata keys, for the
+     *         encoders that write their own tags.
+     * \param[in] destination destination file information.
      *
      */
-    void deinit_lame();
+    QMap<QString, QString> output_tags(const Destination &destination) const;
 
-    /** \brief Flushes the encoder to write the last bytes of the encoder.
+    /** \brief Returns the file name with absolute path of the destination of the given output.
+     * \param[in] output destination output.
+     * \param[in] destination destination file information.
      *
      */
-    void lame_encoder_flush();
+    QString output_file_name(const Output &output, const Destination &destination) const;
 
-    /** \brief Encodes the pcm data in the libav packet to the mp3 buffer and writes it
-     *         to disk.
-     * \param[in] buffer_start starting position in the data buffer to convert.
-     * \param[in] buffer_length number of samples per channel in the data buffer.
+    /** \brief Opens the destination file of the given output.
+     * \param[in] output destination output.
+     * \param[in] destination destination file information.
+     *
+     */
+    bool open_output_file(Output &output, const Destination &destination);
+
+    /** \brief Flushes the encoder and closes the destination file of the given output.
+     * \param[in] output destination output.
+     * \param[in] destination destination file information.
+     *
+     */
+    void close_output_file(Output &output, const Destination &destination);
+
+    /** \brief Encodes the given samples taking into account the positions of the tracks. Closes the actual
+     *         destination and opens the next one each time the samples cross it's boundaries, and skips the
+     *         samples that don't belong to any destination.
+     * \param[in] nb_samples number of samples per channel in the data buffers.
      * \param[in] buffer1 pointer to first buffer (main or left).
      * \param[in] buffer2 pointer to second buffer (unused or right).
      *
      */
-    bool lame_encode_internal_buffer(unsigned int buffer_start, unsigned int buffer_length, unsigned char *buffer1, unsigned char *buffer2);
+    bool encode_block(unsigned int nb_samples, unsigned char *buffer1, unsigned char *buffer2);
+
+    /** \brief Encodes the samples of the batch, if any.
+     *
+     */
+    bool flush_samples();
 
     /** \brief Returns true if the input file can be read and false otherwise.
      *
@@ -196,29 +386,67 @@ class Worker
      */
     bool check_output_file_permissions();
 
+    /** \brief Adds the source and its outputs to the library index after a successful process, so
+     *         it's skipped in the next runs while it doesn't change.
+     *
+     */
+    void update_library_index();
+
     /** \brief Returns the bytes per sample of the source audio.
      *
      */
     int bytes_per_sample() const;
 
+    /** \brief Returns true if the source sample format is planar (one buffer per channel).
+     *
+     */
+    bool is_planar() const;
+
     /** \brief Returns the string for the sample format.
      *
      */
     QString sample_format_string() const;
 
+    /** \brief Selects the output bitrate or VBR quality level, lowering the configured one if the
+     *         source is lossy and has less quality, if enabled in the configuration.
+     * \param[in] output destination output.
+     *
+     */
+    void select_output_bitrate(Output &output);
+
+    /** \brief Returns the nominal bitrate in kbps of the given encoding settings.
+     * \param[in] profile encoding settings.
+     *
+     */
+    int nominal_bitrate(const Utils::OutputProfile &profile) const;
+
     /** \brief Computes the file or files that will be created with the file names already formatted.
      *
      */
     virtual Destinations compute_destinations();
 
-    static const int MP3_BUFFER_SIZE = 33920; /** buffer size used for encoding to MP3. */
-
     Destinations       m_destinations;                /** list of output file destinations.                     */
     int                m_num_tracks;                  /** number of tracks in the source file (from CUE sheet). */
     bool               m_stop;                        /** true if the process needs to abort, false otherwise.  */
-    lame_global_flags *m_gfp;                         /** lame encoder global flags.                            */
-    unsigned char      m_mp3_buffer[MP3_BUFFER_SIZE]; /** encoding buffer.                                      */
-    QFile              m_mp3_file_stream;             /** output mp3 file stream.                               */
+    std::vector<std::unique_ptr<Output>> m_outputs;   /** outputs of the source, the first one is the main one. */
+    int                m_decoder_threads;             /** extra threads granted to the decoder.                 */
+    long long          m_encoded_samples;             /** number of samples encoded in the output file.         */
+    long long          m_written_samples;             /** number of samples encoded in all the destinations.    */
+    long long          m_skipped_samples;             /** number of samples that don't belong to a destination. */
+    long long          m_encode_calls;                /** number of calls to the encoders for the output file.  */
+    unsigned char     *m_batch_buffers[2];            /** batch of samples, one buffer if interleaved.          */
+    unsigned int       m_batch_samples;               /** number of samples per channel in the batch.           */
+    QElapsedTimer      m_encode_timer;                /** measures the encoding time of the output file.        */
+
+    static QMutex s_threads_mutex;   /** protects the threads budget values.                 */
+    static int    s_threads_budget;  /** max number of threads for all the workers.          */
+    static int    s_threads_in_use;  /** threads used by workers and decoders.               */
+    static int    s_running_workers; /** number of existing workers.                         */
+    static int    s_pending_jobs;    /** number of jobs waiting for a worker to process them. */
+
+    static QMutex                               s_statistics_mutex; /** protects the statistics values.                        */
+    static long long                            s_bytes_saved;      /** bytes saved lowering the bitrate to the source quality. */
+    static QMap<QString, Conversion_statistics> s_conversions;      /** decoded and converted bytes of each source codec.       */
 };
 
 #endif // WORKER_H_